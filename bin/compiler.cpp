@@ -1,29 +1,179 @@
 // compiler.cpp - Exam-oriented Mini Compiler in pure C++ (NO Flex/Bison/LLVM)
-// Demonstrates phases: Lexer -> Parser(AST) -> Semantic Analysis(Symbol Table) -> TAC Generation
+// Demonstrates phases: Lexer -> Parser(AST) -> Semantic Analysis(Symbol Table) -> TAC Generation (CFG)
+//                      -> Optimization (inlining, constant propagation, dead code elimination)
+//                      -> SSA optimization (reassociation, SCCP, bounds-check elimination, GVN, LICM,
+//                         IV strength reduction, DCE) -> SLP vectorization -> VM (SSE2/AVX2 vector ops)
 
 #include <iostream>
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <sstream>
 #include <iomanip>
 #include <memory>
 #include <cctype>
 #include <stdexcept>
+#include <cstdint>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <map>
+#include <cstring>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MINI_X86_SIMD 1
+#endif
+// perf_event_open and getrusage; Emscripten (see tools/wasm.cpp) has neither for real.
+#if defined(__linux__) && !defined(__EMSCRIPTEN__)
+#define MINI_LINUX 1
+#endif
+#ifdef MINI_LINUX
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+// =========================================================
+// ALLOCATION COUNTING (optional: build with -DMINI_COUNT_ALLOCS)
+// =========================================================
+// Replaces the global operator new/delete. Every allocation is charged to the
+// current phase (set by the driver) and to the current category (set where
+// tokens, AST nodes, symbols and TAC are built); --stats prints the totals as
+// alloc.* rows. Without the switch the scopes below compile to nothing.
+enum class AllocPhase { Driver, Lex, Parse, Semantic, TAC, Opt, VM, COUNT };
+enum class AllocCategory { Other, Tokens, AST, Symbols, TACStrings, COUNT };
+
+struct AllocCount {
+    uint64_t count = 0, bytes = 0;
+};
+
+#ifdef MINI_COUNT_ALLOCS
+static const char* allocPhaseName(AllocPhase p) {
+    static const char* names[] = {"driver", "lex", "parse", "semantic", "tac", "opt", "vm"};
+    return names[(int)p];
+}
+static const char* allocCategoryName(AllocCategory c) {
+    static const char* names[] = {"other", "tokens", "ast", "symbols", "tac-str"};
+    return names[(int)c];
+}
+
+struct AllocCounters {
+    AllocCount total;
+    AllocCount phase[(int)AllocPhase::COUNT];
+    AllocCount category[(int)AllocCategory::COUNT];
+    AllocPhase curPhase = AllocPhase::Driver;
+    AllocCategory curCategory = AllocCategory::Other;
+};
+static AllocCounters g_allocCounters;
+
+// GCC cannot see that these malloc/free pairs belong together.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t n) {
+    AllocCounters& c = g_allocCounters;
+    c.total.count++;
+    c.total.bytes += n;
+    c.phase[(int)c.curPhase].count++;
+    c.phase[(int)c.curPhase].bytes += n;
+    c.category[(int)c.curCategory].count++;
+    c.category[(int)c.curCategory].bytes += n;
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+class AllocPhaseScope {
+    AllocPhase saved;
+
+public:
+    explicit AllocPhaseScope(AllocPhase p) : saved(g_allocCounters.curPhase) { g_allocCounters.curPhase = p; }
+    ~AllocPhaseScope() { g_allocCounters.curPhase = saved; }
+    AllocPhaseScope(const AllocPhaseScope&) = delete;
+    AllocPhaseScope& operator=(const AllocPhaseScope&) = delete;
+};
+
+class AllocCategoryScope {
+    AllocCategory saved;
+
+public:
+    explicit AllocCategoryScope(AllocCategory c) : saved(g_allocCounters.curCategory) { g_allocCounters.curCategory = c; }
+    ~AllocCategoryScope() { g_allocCounters.curCategory = saved; }
+    AllocCategoryScope(const AllocCategoryScope&) = delete;
+    AllocCategoryScope& operator=(const AllocCategoryScope&) = delete;
+};
+#else
+struct AllocPhaseScope {
+    explicit AllocPhaseScope(AllocPhase) {}
+};
+struct AllocCategoryScope {
+    explicit AllocCategoryScope(AllocCategory) {}
+};
+#endif
+
+// =========================================================
+// RESOURCE LIMITS (--max-tokens, --max-nodes, --max-depth, --max-temps, --time-budget-ms)
+// =========================================================
+// Bound the work a single input can cause. Each phase checks its own counter
+// where it already loops, and reads the clock for the wall-time budget only
+// every LIMIT_CHECK_EVERY units. Going over a limit aborts with a "Limit
+// error" diagnostic. 0 means unlimited; the depth limit defaults to a value
+// that keeps the recursive phases inside an 8 MB stack even in sanitizer builds.
+struct CompileLimits {
+    size_t maxTokens = 0;
+    size_t maxNodes = 0;
+    size_t maxDepth = 1000;   // parser recursion and expression tree height
+    size_t maxTemps = 0;
+    double timeBudgetMs = 0;
+    bool hasDeadline = false;
+    chrono::steady_clock::time_point deadline;
+};
+static CompileLimits g_limits;
+static const size_t LIMIT_CHECK_EVERY = 1024;
+
+[[noreturn]] static void limitError(const string& msg, int line = 0, int col = 0) {
+    ostringstream oss;
+    oss << "Limit error";
+    if (line > 0) oss << " at " << line << ":" << col;
+    oss << ": " << msg;
+    throw runtime_error(oss.str());
+}
+
+static void startTimeBudget() {
+    if (g_limits.timeBudgetMs <= 0) return;
+    g_limits.hasDeadline = true;
+    g_limits.deadline = chrono::steady_clock::now() +
+                        chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(g_limits.timeBudgetMs));
+}
+
+static void checkTimeBudget(const char* phase) {
+    if (!g_limits.hasDeadline || chrono::steady_clock::now() <= g_limits.deadline) return;
+    ostringstream oss;
+    oss << "compile time budget of " << g_limits.timeBudgetMs << " ms exceeded during " << phase << " (--time-budget-ms).";
+    limitError(oss.str());
+}
+
 // =========================================================
 // 1) LEXICAL ANALYSIS (LEXER)
 // =========================================================
 enum class TokenType {
-    KW_INT, KW_PRINT,
+    KW_INT, KW_PRINT, KW_IF, KW_ELSE, KW_WHILE, KW_RETURN,
     IDENT, NUMBER,
 
     PLUS, MINUS, MUL, DIV,
     ASSIGN,
+    LT, LE, GT, GE, EQ, NE,
 
-    SEMI, LPAREN, RPAREN,
+    SEMI, COMMA, LPAREN, RPAREN, LBRACE, RBRACE, LBRACKET, RBRACKET,
     END
 };
 
@@ -36,17 +186,32 @@ struct Token {
 static string tokenCategory(TokenType tt) {
     switch (tt) {
         case TokenType::KW_INT:
-        case TokenType::KW_PRINT: return "KEYWORD";
+        case TokenType::KW_PRINT:
+        case TokenType::KW_IF:
+        case TokenType::KW_ELSE:
+        case TokenType::KW_WHILE:
+        case TokenType::KW_RETURN: return "KEYWORD";
         case TokenType::IDENT:    return "IDENTIFIER";
         case TokenType::NUMBER:   return "NUMBER";
         case TokenType::PLUS:
         case TokenType::MINUS:
         case TokenType::MUL:
         case TokenType::DIV:
-        case TokenType::ASSIGN:   return "OPERATOR";
+        case TokenType::ASSIGN:
+        case TokenType::LT:
+        case TokenType::LE:
+        case TokenType::GT:
+        case TokenType::GE:
+        case TokenType::EQ:
+        case TokenType::NE:       return "OPERATOR";
         case TokenType::SEMI:
+        case TokenType::COMMA:
         case TokenType::LPAREN:
-        case TokenType::RPAREN:   return "SYMBOL";
+        case TokenType::RPAREN:
+        case TokenType::LBRACE:
+        case TokenType::RBRACE:
+        case TokenType::LBRACKET:
+        case TokenType::RBRACKET: return "SYMBOL";
         case TokenType::END:      return "EOF";
     }
     return "UNKNOWN";
@@ -94,8 +259,11 @@ class Lexer {
 
 public:
     explicit Lexer(string s) : src(std::move(s)) {}
+    // Text that starts at the beginning of line firstLine of a larger document.
+    Lexer(string s, int firstLine) : src(std::move(s)), line(firstLine) {}
 
     vector<Token> tokenize() {
+        AllocCategoryScope tag(AllocCategory::Tokens);
         vector<Token> tokens;
 
         while (true) {
@@ -107,6 +275,9 @@ public:
                 tokens.push_back({TokenType::END, "EOF", startLine, startCol});
                 break;
             }
+            if (tokens.size() % LIMIT_CHECK_EVERY == 0) checkTimeBudget("lexing");
+            if (g_limits.maxTokens && tokens.size() >= g_limits.maxTokens)
+                limitError("more than " + to_string(g_limits.maxTokens) + " tokens (--max-tokens).", startLine, startCol);
 
             // identifier / keyword
             if (isalpha((unsigned char)c) || c == '_') {
@@ -116,6 +287,10 @@ public:
 
                 if (lex == "int")   tokens.push_back({TokenType::KW_INT, lex, startLine, startCol});
                 else if (lex == "print") tokens.push_back({TokenType::KW_PRINT, lex, startLine, startCol});
+                else if (lex == "if")    tokens.push_back({TokenType::KW_IF, lex, startLine, startCol});
+                else if (lex == "else")  tokens.push_back({TokenType::KW_ELSE, lex, startLine, startCol});
+                else if (lex == "while") tokens.push_back({TokenType::KW_WHILE, lex, startLine, startCol});
+                else if (lex == "return") tokens.push_back({TokenType::KW_RETURN, lex, startLine, startCol});
                 else tokens.push_back({TokenType::IDENT, lex, startLine, startCol});
                 continue;
             }
@@ -129,6 +304,18 @@ public:
                 continue;
             }
 
+            // two-character comparison operators
+            if ((c == '<' || c == '>' || c == '=' || c == '!') && peek(1) == '=') {
+                get(); get();
+                switch (c) {
+                    case '<': tokens.push_back({TokenType::LE, "<=", startLine, startCol}); break;
+                    case '>': tokens.push_back({TokenType::GE, ">=", startLine, startCol}); break;
+                    case '=': tokens.push_back({TokenType::EQ, "==", startLine, startCol}); break;
+                    default:  tokens.push_back({TokenType::NE, "!=", startLine, startCol}); break;
+                }
+                continue;
+            }
+
             // operators / symbols
             switch (c) {
                 case '+': get(); tokens.push_back({TokenType::PLUS, "+", startLine, startCol}); continue;
@@ -137,8 +324,15 @@ public:
                 case '/': get(); tokens.push_back({TokenType::DIV, "/", startLine, startCol}); continue;
                 case '=': get(); tokens.push_back({TokenType::ASSIGN, "=", startLine, startCol}); continue;
                 case ';': get(); tokens.push_back({TokenType::SEMI, ";", startLine, startCol}); continue;
+                case ',': get(); tokens.push_back({TokenType::COMMA, ",", startLine, startCol}); continue;
                 case '(': get(); tokens.push_back({TokenType::LPAREN, "(", startLine, startCol}); continue;
                 case ')': get(); tokens.push_back({TokenType::RPAREN, ")", startLine, startCol}); continue;
+                case '{': get(); tokens.push_back({TokenType::LBRACE, "{", startLine, startCol}); continue;
+                case '}': get(); tokens.push_back({TokenType::RBRACE, "}", startLine, startCol}); continue;
+                case '[': get(); tokens.push_back({TokenType::LBRACKET, "[", startLine, startCol}); continue;
+                case ']': get(); tokens.push_back({TokenType::RBRACKET, "]", startLine, startCol}); continue;
+                case '<': get(); tokens.push_back({TokenType::LT, "<", startLine, startCol}); continue;
+                case '>': get(); tokens.push_back({TokenType::GT, ">", startLine, startCol}); continue;
                 default:  lexError(c, startLine, startCol);
             }
         }
@@ -150,7 +344,10 @@ public:
 // =========================================================
 // AST NODES (Parser output)
 // =========================================================
-struct Expr { virtual ~Expr() = default; };
+struct Expr {
+    int height = 1;   // longest path down to a leaf, bounded by --max-depth
+    virtual ~Expr() = default;
+};
 
 struct NumExpr : Expr {
     Token tok;
@@ -162,30 +359,50 @@ struct VarExpr : Expr {
     explicit VarExpr(Token t) : tok(std::move(t)) {}
 };
 
+struct IndexExpr : Expr {
+    Token name;   // the array
+    unique_ptr<Expr> index;
+    IndexExpr(Token n, unique_ptr<Expr> i) : name(std::move(n)), index(std::move(i)) { height = 1 + index->height; }
+};
+
+struct CallExpr : Expr {
+    Token name;   // the function
+    vector<unique_ptr<Expr>> args;
+    CallExpr(Token n, vector<unique_ptr<Expr>> a) : name(std::move(n)), args(std::move(a)) {
+        for (const auto& x : args) height = max(height, 1 + x->height);
+    }
+};
+
 struct UnaryExpr : Expr {
     Token op;
     unique_ptr<Expr> rhs;
-    UnaryExpr(Token oper, unique_ptr<Expr> r) : op(std::move(oper)), rhs(std::move(r)) {}
+    UnaryExpr(Token oper, unique_ptr<Expr> r) : op(std::move(oper)), rhs(std::move(r)) { height = 1 + rhs->height; }
 };
 
 struct BinaryExpr : Expr {
     Token op;
     unique_ptr<Expr> lhs, rhs;
     BinaryExpr(unique_ptr<Expr> l, Token oper, unique_ptr<Expr> r)
-        : op(std::move(oper)), lhs(std::move(l)), rhs(std::move(r)) {}
+        : op(std::move(oper)), lhs(std::move(l)), rhs(std::move(r)) {
+        height = 1 + max(lhs->height, rhs->height);
+    }
 };
 
 struct Stmt { virtual ~Stmt() = default; };
 
 struct DeclStmt : Stmt {
     Token name;
-    explicit DeclStmt(Token n) : name(std::move(n)) {}
+    Token size;   // NUMBER for 'int a[N];', END for a scalar
+    DeclStmt(Token n, Token sz) : name(std::move(n)), size(std::move(sz)) {}
+    bool isArray() const { return size.type == TokenType::NUMBER; }
 };
 
 struct AssignStmt : Stmt {
     Token name;
+    unique_ptr<Expr> index;   // element index for 'a[i] = e', null for a scalar
     unique_ptr<Expr> rhs;
-    AssignStmt(Token n, unique_ptr<Expr> e) : name(std::move(n)), rhs(std::move(e)) {}
+    AssignStmt(Token n, unique_ptr<Expr> i, unique_ptr<Expr> e)
+        : name(std::move(n)), index(std::move(i)), rhs(std::move(e)) {}
 };
 
 struct PrintStmt : Stmt {
@@ -194,6 +411,46 @@ struct PrintStmt : Stmt {
     PrintStmt(Token k, unique_ptr<Expr> e) : kw(std::move(k)), expr(std::move(e)) {}
 };
 
+struct ReturnStmt : Stmt {
+    Token kw; // 'return'
+    unique_ptr<Expr> value;
+    ReturnStmt(Token k, unique_ptr<Expr> v) : kw(std::move(k)), value(std::move(v)) {}
+};
+
+// A call whose result is not used: f(x);
+struct CallStmt : Stmt {
+    unique_ptr<Expr> call;
+    explicit CallStmt(unique_ptr<Expr> c) : call(std::move(c)) {}
+};
+
+// int f(int a, int b) { ... }   (top level only; every function returns int)
+struct FuncDecl : Stmt {
+    Token name;
+    vector<Token> params;
+    vector<unique_ptr<Stmt>> body;   // local declarations and statements
+    FuncDecl(Token n, vector<Token> ps) : name(std::move(n)), params(std::move(ps)) {}
+};
+
+struct BlockStmt : Stmt {
+    vector<unique_ptr<Stmt>> stmts;
+};
+
+struct IfStmt : Stmt {
+    Token kw; // 'if'
+    unique_ptr<Expr> cond;
+    unique_ptr<Stmt> thenS, elseS; // elseS may be null
+    IfStmt(Token k, unique_ptr<Expr> c, unique_ptr<Stmt> t, unique_ptr<Stmt> e)
+        : kw(std::move(k)), cond(std::move(c)), thenS(std::move(t)), elseS(std::move(e)) {}
+};
+
+struct WhileStmt : Stmt {
+    Token kw; // 'while'
+    unique_ptr<Expr> cond;
+    unique_ptr<Stmt> body;
+    WhileStmt(Token k, unique_ptr<Expr> c, unique_ptr<Stmt> b)
+        : kw(std::move(k)), cond(std::move(c)), body(std::move(b)) {}
+};
+
 struct Program {
     vector<unique_ptr<Stmt>> stmts;
 };
@@ -204,6 +461,7 @@ struct Program {
 class Parser {
     const vector<Token>& t;
     size_t p = 0;
+    size_t nodes = 0, depth = 0;   // for --max-nodes and --max-depth
 
     const Token& cur() const { return t[p]; }
     bool at(TokenType tt) const { return cur().type == tt; }
@@ -220,31 +478,116 @@ class Parser {
         return t[p++];
     }
 
+    [[noreturn]] void depthError() const {
+        limitError("expressions or statements nested more than " + to_string(g_limits.maxDepth) +
+                   " levels deep (--max-depth).", cur().line, cur().col);
+    }
+
+    // Every AST node is made here, so the node and depth limits see all of them.
+    template <class T, class... Args>
+    unique_ptr<T> node(Args&&... args) {
+        if (++nodes % LIMIT_CHECK_EVERY == 0) checkTimeBudget("parsing");
+        if (g_limits.maxNodes && nodes > g_limits.maxNodes)
+            limitError("more than " + to_string(g_limits.maxNodes) + " AST nodes (--max-nodes).", cur().line, cur().col);
+        auto n = make_unique<T>(std::forward<Args>(args)...);
+        if constexpr (is_base_of<Expr, T>::value) {
+            if (g_limits.maxDepth && (size_t)n->height > g_limits.maxDepth) depthError();
+        }
+        return n;
+    }
+
+    // One level of recursive descent (statement, expression or unary operator).
+    class Nest {
+        size_t& depth;
+
+    public:
+        explicit Nest(Parser& ps) : depth(ps.depth) {
+            if (++depth > g_limits.maxDepth && g_limits.maxDepth) ps.depthError();
+        }
+        ~Nest() { depth--; }
+        Nest(const Nest&) = delete;
+        Nest& operator=(const Nest&) = delete;
+    };
+
+    TokenType ahead(size_t k) const { return p + k < t.size() ? t[p + k].type : TokenType::END; }
+
     bool isStartDecl() const { return at(TokenType::KW_INT); }
-    bool isStartStmt() const { return at(TokenType::IDENT) || at(TokenType::KW_PRINT); }
+    bool isStartFunc() const { return at(TokenType::KW_INT) && ahead(1) == TokenType::IDENT && ahead(2) == TokenType::LPAREN; }
+    bool isStartStmt() const {
+        return at(TokenType::IDENT) || at(TokenType::KW_PRINT) || at(TokenType::KW_IF) ||
+               at(TokenType::KW_WHILE) || at(TokenType::KW_RETURN) || at(TokenType::LBRACE);
+    }
 
-    // Program -> {Decl | Stmt} EOF
+    // Program -> {Func | Decl | Stmt} EOF
     Program parseProgram() {
         Program prog;
-        while (!at(TokenType::END)) {
-            if (isStartDecl()) prog.stmts.push_back(parseDecl());
-            else if (isStartStmt()) prog.stmts.push_back(parseStmt());
-            else syntaxError("Expected 'int' declaration or a statement (assignment/print).");
-        }
+        while (!at(TokenType::END)) prog.stmts.push_back(parseItem());
         expect(TokenType::END, "Expected EOF.");
         return prog;
     }
 
-    // Decl -> "int" IDENT ";"
-    unique_ptr<Stmt> parseDecl() {
+    unique_ptr<Stmt> parseItem() {
+        if (isStartFunc()) return parseFunc();
+        if (isStartDecl()) return parseDecl();
+        if (isStartStmt()) return parseStmt();
+        syntaxError("Expected 'int' declaration, a function or a statement (assignment/print/if/while/block).");
+    }
+
+    // Func -> "int" IDENT "(" ["int" IDENT {"," "int" IDENT}] ")" "{" {Decl | Stmt} "}"
+    unique_ptr<Stmt> parseFunc() {
         expect(TokenType::KW_INT, "Expected 'int'.");
+        Token name = expect(TokenType::IDENT, "Expected function name after 'int'.");
+        expect(TokenType::LPAREN, "Expected '(' after function name.");
+        vector<Token> params;
+        while (!at(TokenType::RPAREN)) {
+            if (!params.empty()) expect(TokenType::COMMA, "Expected ',' or ')' after parameter.");
+            expect(TokenType::KW_INT, "Expected 'int' before parameter name.");
+            params.push_back(expect(TokenType::IDENT, "Expected parameter name after 'int'."));
+        }
+        expect(TokenType::RPAREN, "Expected ')' after parameters.");
+        expect(TokenType::LBRACE, "Expected '{' to start the function body.");
+        auto fn = node<FuncDecl>(name, std::move(params));
+        while (!at(TokenType::RBRACE)) {
+            if (isStartFunc()) syntaxError("Functions can only be declared at the top level.");
+            if (isStartDecl()) fn->body.push_back(parseDecl());
+            else if (isStartStmt()) fn->body.push_back(parseStmt());
+            else syntaxError("Expected a declaration, a statement or '}' to close the function body.");
+        }
+        expect(TokenType::RBRACE, "Expected '}'.");
+        return fn;
+    }
+
+    // Decl -> "int" IDENT ["[" NUMBER "]"] ";"
+    unique_ptr<Stmt> parseDecl() {
+        Token kw = expect(TokenType::KW_INT, "Expected 'int'.");
         Token id = expect(TokenType::IDENT, "Expected identifier after 'int'.");
+        Token size{TokenType::END, "", kw.line, kw.col};
+        if (at(TokenType::LBRACKET)) {
+            p++;
+            size = expect(TokenType::NUMBER, "Expected array size (a number) after '['.");
+            expect(TokenType::RBRACKET, "Expected ']' after array size.");
+        }
         expect(TokenType::SEMI, "Expected ';' after declaration.");
-        return make_unique<DeclStmt>(id);
+        return node<DeclStmt>(id, size);
     }
 
-    // Stmt -> Assign ";" | Print ";"
+    // Stmt -> Assign ";" | Call ";" | Print ";" | Return ";" | If | While | Block
     unique_ptr<Stmt> parseStmt() {
+        Nest nest(*this);
+        if (at(TokenType::KW_IF)) return parseIf();
+        if (at(TokenType::KW_WHILE)) return parseWhile();
+        if (at(TokenType::LBRACE)) return parseBlock();
+        if (at(TokenType::IDENT) && ahead(1) == TokenType::LPAREN) {
+            auto s = node<CallStmt>(parsePrimary());
+            expect(TokenType::SEMI, "Expected ';' after call.");
+            return s;
+        }
+        if (at(TokenType::KW_RETURN)) {
+            Token kw = cur(); p++;
+            auto s = node<ReturnStmt>(kw, parseExpr());
+            expect(TokenType::SEMI, "Expected ';' after return.");
+            return s;
+        }
         if (at(TokenType::IDENT)) {
             auto s = parseAssign();
             expect(TokenType::SEMI, "Expected ';' after assignment.");
@@ -259,39 +602,159 @@ class Parser {
         return nullptr;
     }
 
-    // Assign -> IDENT "=" Expr
+    // Block -> "{" {Stmt} "}"   (declarations stay at the top level)
+    unique_ptr<Stmt> parseBlock() {
+        expect(TokenType::LBRACE, "Expected '{'.");
+        auto blk = node<BlockStmt>();
+        while (!at(TokenType::RBRACE)) {
+            if (isStartDecl()) syntaxError("Declarations are only allowed at the top level.");
+            if (!isStartStmt()) syntaxError("Expected a statement or '}' to close '{'.");
+            blk->stmts.push_back(parseStmt());
+        }
+        expect(TokenType::RBRACE, "Expected '}'.");
+        return blk;
+    }
+
+    // If -> "if" "(" Cond ")" Stmt ["else" Stmt]
+    unique_ptr<Stmt> parseIf() {
+        Token kw = expect(TokenType::KW_IF, "Expected 'if'.");
+        expect(TokenType::LPAREN, "Expected '(' after 'if'.");
+        auto c = parseCond();
+        expect(TokenType::RPAREN, "Expected ')' after condition.");
+        auto thenS = parseStmt();
+        unique_ptr<Stmt> elseS;
+        if (at(TokenType::KW_ELSE)) {
+            p++;
+            elseS = parseStmt();
+        }
+        return node<IfStmt>(kw, std::move(c), std::move(thenS), std::move(elseS));
+    }
+
+    // While -> "while" "(" Cond ")" Stmt
+    unique_ptr<Stmt> parseWhile() {
+        Token kw = expect(TokenType::KW_WHILE, "Expected 'while'.");
+        expect(TokenType::LPAREN, "Expected '(' after 'while'.");
+        auto c = parseCond();
+        expect(TokenType::RPAREN, "Expected ')' after condition.");
+        auto body = parseStmt();
+        return node<WhileStmt>(kw, std::move(c), std::move(body));
+    }
+
+    bool atRelOp() const {
+        return at(TokenType::LT) || at(TokenType::LE) || at(TokenType::GT) ||
+               at(TokenType::GE) || at(TokenType::EQ) || at(TokenType::NE);
+    }
+
+    // Cond -> Expr [RelOp Expr]   (a bare Expr is true when non-zero)
+    unique_ptr<Expr> parseCond() {
+        auto left = parseExpr();
+        if (atRelOp()) {
+            Token op = cur(); p++;
+            auto right = parseExpr();
+            left = node<BinaryExpr>(std::move(left), op, std::move(right));
+        }
+        return left;
+    }
+
+    // Assign -> IDENT ["[" Expr "]"] "=" Expr
     unique_ptr<Stmt> parseAssign() {
         Token id = expect(TokenType::IDENT, "Expected identifier.");
+        unique_ptr<Expr> index;
+        if (at(TokenType::LBRACKET)) index = parseIndex();
         expect(TokenType::ASSIGN, "Expected '=' in assignment.");
         auto e = parseExpr();
-        return make_unique<AssignStmt>(id, std::move(e));
+        return node<AssignStmt>(id, std::move(index), std::move(e));
+    }
+
+    // Index -> "[" Expr "]"
+    unique_ptr<Expr> parseIndex() {
+        expect(TokenType::LBRACKET, "Expected '['.");
+        auto e = parseExpr();
+        expect(TokenType::RBRACKET, "Expected ']' after array index.");
+        return e;
     }
 
     // Print -> "print" Expr
     unique_ptr<Stmt> parsePrint() {
         Token kw = expect(TokenType::KW_PRINT, "Expected 'print'.");
         auto e = parseExpr();
-        return make_unique<PrintStmt>(kw, std::move(e));
+        return node<PrintStmt>(kw, std::move(e));
+    }
+
+    // Operator chains longer than this are built as balanced trees, so a long
+    // a + b + ... does not count as nesting against --max-depth or recurse that
+    // deep in later phases. Operands are still evaluated left to right, and
+    // regrouping is exact under wrap-around. Shorter chains stay left-leaning.
+    static const size_t BALANCE_MIN_TERMS = 16;
+
+    static Token withType(Token op, TokenType tt) {
+        op.type = tt;
+        op.lexeme = tt == TokenType::PLUS ? "+" : tt == TokenType::MINUS ? "-" : "*";
+        return op;
+    }
+
+    // terms[l] ops[l+1] terms[l+1] ... ops[r] terms[r], with + and - swapped
+    // when flip (the chain is the right operand of a '-').
+    unique_ptr<Expr> balancedSum(vector<unique_ptr<Expr>>& terms, const vector<Token>& ops, size_t l, size_t r, bool flip) {
+        if (l == r) return std::move(terms[l]);
+        size_t mid = (l + r + 1) / 2;
+        bool minus = (ops[mid].type == TokenType::MINUS) != flip;
+        auto left = balancedSum(terms, ops, l, mid - 1, flip);
+        auto right = balancedSum(terms, ops, mid, r, flip != minus);   // a - (b + c) == a - b - c
+        return node<BinaryExpr>(std::move(left), withType(ops[mid], minus ? TokenType::MINUS : TokenType::PLUS), std::move(right));
+    }
+
+    unique_ptr<Expr> balancedProduct(vector<unique_ptr<Expr>>& factors, const vector<Token>& ops, size_t l, size_t r) {
+        if (l == r) return std::move(factors[l]);
+        size_t mid = (l + r + 1) / 2;
+        auto left = balancedProduct(factors, ops, l, mid - 1);
+        auto right = balancedProduct(factors, ops, mid, r);
+        return node<BinaryExpr>(std::move(left), withType(ops[mid], TokenType::MUL), std::move(right));
     }
 
     // Expr -> Term {(+|-) Term}
     unique_ptr<Expr> parseExpr() {
-        auto left = parseTerm();
+        Nest nest(*this);
+        vector<unique_ptr<Expr>> terms;
+        vector<Token> ops(1, cur());   // ops[k] joins terms[k - 1] and terms[k]
+        terms.push_back(parseTerm());
         while (at(TokenType::PLUS) || at(TokenType::MINUS)) {
-            Token op = cur(); p++;
-            auto right = parseTerm();
-            left = make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+            ops.push_back(cur()); p++;
+            terms.push_back(parseTerm());
         }
+        if (terms.size() >= BALANCE_MIN_TERMS) return balancedSum(terms, ops, 0, terms.size() - 1, false);
+        auto left = std::move(terms[0]);
+        for (size_t k = 1; k < terms.size(); k++) left = node<BinaryExpr>(std::move(left), ops[k], std::move(terms[k]));
         return left;
     }
 
     // Term -> Unary {(*|/) Unary}
+    // A '/' is not associative, so only the runs of '*' between divisions are balanced.
     unique_ptr<Expr> parseTerm() {
-        auto left = parseUnary();
+        vector<unique_ptr<Expr>> factors;
+        vector<Token> ops(1, cur());
+        factors.push_back(parseUnary());
         while (at(TokenType::MUL) || at(TokenType::DIV)) {
-            Token op = cur(); p++;
-            auto right = parseUnary();
-            left = make_unique<BinaryExpr>(std::move(left), op, std::move(right));
+            ops.push_back(cur()); p++;
+            factors.push_back(parseUnary());
+        }
+        if (factors.size() < BALANCE_MIN_TERMS) {
+            auto left = std::move(factors[0]);
+            for (size_t k = 1; k < factors.size(); k++) left = node<BinaryExpr>(std::move(left), ops[k], std::move(factors[k]));
+            return left;
+        }
+        unique_ptr<Expr> left;
+        for (size_t k = 0; k < factors.size();) {
+            if (k > 0 && ops[k].type == TokenType::DIV) {
+                left = node<BinaryExpr>(std::move(left), ops[k], std::move(factors[k]));
+                k++;
+                continue;
+            }
+            size_t end = k + 1;   // factors[k..end) are joined by '*'
+            while (end < factors.size() && ops[end].type == TokenType::MUL) end++;
+            auto run = balancedProduct(factors, ops, k, end - 1);
+            left = left ? node<BinaryExpr>(std::move(left), ops[k], std::move(run)) : std::move(run);
+            k = end;
         }
         return left;
     }
@@ -299,22 +762,34 @@ class Parser {
     // Unary -> (+|-) Unary | Primary
     unique_ptr<Expr> parseUnary() {
         if (at(TokenType::PLUS) || at(TokenType::MINUS)) {
+            Nest nest(*this);
             Token op = cur(); p++;
             auto rhs = parseUnary();
-            return make_unique<UnaryExpr>(op, std::move(rhs));
+            return node<UnaryExpr>(op, std::move(rhs));
         }
         return parsePrimary();
     }
 
-    // Primary -> NUMBER | IDENT | "(" Expr ")"
+    // Primary -> NUMBER | IDENT [Index] | IDENT "(" [Expr {"," Expr}] ")" | "(" Expr ")"
     unique_ptr<Expr> parsePrimary() {
         if (at(TokenType::NUMBER)) {
             Token n = cur(); p++;
-            return make_unique<NumExpr>(n);
+            return node<NumExpr>(n);
         }
         if (at(TokenType::IDENT)) {
             Token id = cur(); p++;
-            return make_unique<VarExpr>(id);
+            if (at(TokenType::LBRACKET)) return node<IndexExpr>(id, parseIndex());
+            if (at(TokenType::LPAREN)) {
+                p++;
+                vector<unique_ptr<Expr>> args;
+                while (!at(TokenType::RPAREN)) {
+                    if (!args.empty()) expect(TokenType::COMMA, "Expected ',' or ')' after argument.");
+                    args.push_back(parseExpr());
+                }
+                expect(TokenType::RPAREN, "Expected ')' after arguments.");
+                return node<CallExpr>(id, std::move(args));
+            }
+            return node<VarExpr>(id);
         }
         if (at(TokenType::LPAREN)) {
             p++;
@@ -328,20 +803,50 @@ class Parser {
 
 public:
     explicit Parser(const vector<Token>& tokens) : t(tokens) {}
-    Program parse() { return parseProgram(); }
+    Program parse() {
+        AllocCategoryScope tag(AllocCategory::AST);
+        return parseProgram();
+    }
+
+    // Session mode parses one top-level item at a time from any item boundary,
+    // and counts the nodes of items it kept from an earlier parse.
+    bool atEnd() const { return at(TokenType::END); }
+    size_t position() const { return p; }
+    void seek(size_t pos) { p = pos; }
+    size_t nodeCount() const { return nodes; }
+    unique_ptr<Stmt> parseTopLevel() {
+        AllocCategoryScope tag(AllocCategory::AST);
+        return parseItem();
+    }
+    void countReused(size_t n) {
+        nodes += n;
+        if (g_limits.maxNodes && nodes > g_limits.maxNodes)
+            limitError("more than " + to_string(g_limits.maxNodes) + " AST nodes (--max-nodes).", cur().line, cur().col);
+    }
 };
 
 // =========================================================
 // 3) SEMANTIC ANALYSIS (Symbol Table + checks)
 // =========================================================
 struct Symbol {
-    string name;
-    string type;   // only "int"
+    string name;   // locals and parameters are keyed "f::x"
+    string type;   // "int", "int[N]" for an array, "int(int, int)" for a function
+    Token decl;
+    int32_t size = 0;   // element count of an array, 0 for a scalar
+    int arity = -1;     // parameter count of a function, -1 for variables
+    bool param = false;
+    bool read = false;  // for a function: called from somewhere else than itself
+    bool assigned = false;
 };
 
+static const int32_t MAX_ARRAY_SIZE = 1000000;
+
 class SemanticAnalyzer {
     unordered_map<string, Symbol> table;
     vector<string> order;
+    vector<string> warns;
+    string fn;   // function being checked, empty at the top level
+    size_t checked = 0;   // statements, for the time budget
 
     [[noreturn]] void semError(const Token& where, const string& msg) const {
         ostringstream oss;
@@ -350,14 +855,90 @@ class SemanticAnalyzer {
         throw runtime_error(oss.str());
     }
 
+    void semWarning(const Token& where, const string& msg) {
+        ostringstream oss;
+        oss << "Semantic warning at " << where.line << ":" << where.col
+            << " near '" << where.lexeme << "': " << msg;
+        warns.push_back(oss.str());
+    }
+
+    Symbol& declare(const Token& name, Symbol sym) {
+        AllocCategoryScope tag(AllocCategory::Symbols);
+        string key = fn.empty() ? name.lexeme : fn + "::" + name.lexeme;
+        if (table.find(key) != table.end())
+            semError(name, "Duplicate declaration of '" + name.lexeme + "'.");
+        sym.name = key;
+        order.push_back(key);
+        return table[key] = std::move(sym);
+    }
+
+    // Locals and parameters of the current function first, then globals.
+    // Inside a function the only visible globals are arrays.
+    Symbol* findVar(const Token& tok) {
+        if (!fn.empty()) {
+            auto it = table.find(fn + "::" + tok.lexeme);
+            if (it != table.end()) return &it->second;
+        }
+        auto it = table.find(tok.lexeme);
+        if (it == table.end()) return nullptr;
+        if (it->second.arity >= 0)
+            semError(tok, "'" + tok.lexeme + "' is a function, not a variable.");
+        if (!fn.empty() && it->second.size == 0)
+            semError(tok, "Global variable '" + tok.lexeme + "' is not visible inside function '" + fn +
+                              "' (pass it as a parameter).");
+        return &it->second;
+    }
+
+    // Index expressions of an array element; a literal index must be in range.
+    Symbol& checkElement(const Token& name, const Expr* index) {
+        Symbol* sym = findVar(name);
+        if (!sym)
+            semError(name, "Array '" + name.lexeme + "' used before declaration.");
+        if (sym->size == 0)
+            semError(name, "Variable '" + name.lexeme + "' is not an array.");
+        checkExpr(index);
+        if (auto n = dynamic_cast<const NumExpr*>(index)) {
+            if (n->tok.lexeme.size() > 10 || stoll(n->tok.lexeme) >= sym->size)
+                semError(n->tok, "Index " + n->tok.lexeme + " is out of bounds for '" + sym->name + "[" +
+                                     to_string(sym->size) + "]'.");
+        }
+        return *sym;
+    }
+
+    void checkCall(const CallExpr* c) {
+        const string& name = c->name.lexeme;
+        auto it = table.find(name);
+        if (it == table.end())
+            semError(c->name, "Function '" + name + "' called before declaration.");
+        if (it->second.arity < 0)
+            semError(c->name, "'" + name + "' is not a function.");
+        if ((int)c->args.size() != it->second.arity)
+            semError(c->name, "Function '" + name + "' expects " + to_string(it->second.arity) +
+                                  " argument(s), got " + to_string(c->args.size()) + ".");
+        for (const auto& a : c->args) checkExpr(a.get());
+        if (name != fn) it->second.read = true;   // recursion alone is not a use
+    }
+
     void checkExpr(const Expr* e) {
         if (auto n = dynamic_cast<const NumExpr*>(e)) {
             (void)n; // ok
             return;
         }
         if (auto v = dynamic_cast<const VarExpr*>(e)) {
-            if (table.find(v->tok.lexeme) == table.end())
+            Symbol* sym = findVar(v->tok);
+            if (!sym)
                 semError(v->tok, "Variable '" + v->tok.lexeme + "' used before declaration.");
+            if (sym->size != 0)
+                semError(v->tok, "Array '" + v->tok.lexeme + "' must be indexed.");
+            sym->read = true;
+            return;
+        }
+        if (auto ix = dynamic_cast<const IndexExpr*>(e)) {
+            checkElement(ix->name, ix->index.get()).read = true;
+            return;
+        }
+        if (auto c = dynamic_cast<const CallExpr*>(e)) {
+            checkCall(c);
             return;
         }
         if (auto u = dynamic_cast<const UnaryExpr*>(e)) {
@@ -372,44 +953,277 @@ class SemanticAnalyzer {
         throw runtime_error("Internal error: Unknown Expr node in semantic analysis.");
     }
 
-public:
-    void analyze(const Program& prog) {
-        for (const auto& st : prog.stmts) {
-            if (auto d = dynamic_cast<const DeclStmt*>(st.get())) {
-                const string& name = d->name.lexeme;
-                if (table.find(name) != table.end())
-                    semError(d->name, "Duplicate declaration of '" + name + "'.");
-                table[name] = Symbol{name, "int"};
-                order.push_back(name);
-                continue;
+    void checkStmt(const Stmt* st) {
+        if (++checked % LIMIT_CHECK_EVERY == 0) checkTimeBudget("semantic analysis");
+        if (auto d = dynamic_cast<const DeclStmt*>(st)) {
+            Symbol sym{"", "int", d->name};
+            if (d->isArray()) {
+                if (!fn.empty()) semError(d->name, "Arrays can only be declared at the top level.");
+                const string& n = d->size.lexeme;
+                if (n.size() > 7 || stoll(n) < 1 || stoll(n) > MAX_ARRAY_SIZE)
+                    semError(d->size, "Array size must be between 1 and " + to_string(MAX_ARRAY_SIZE) + ".");
+                sym.size = (int32_t)stoll(n);
+                sym.type = "int[" + to_string(sym.size) + "]";
+            }
+            declare(d->name, sym);
+            return;
+        }
+        if (auto f = dynamic_cast<const FuncDecl*>(st)) {
+            string type = "int(";
+            for (size_t k = 0; k < f->params.size(); k++) type += k ? ", int" : "int";
+            Symbol sym{"", type + ")", f->name};
+            sym.arity = (int)f->params.size();
+            declare(f->name, sym);
+            fn = f->name.lexeme;
+            for (const auto& p : f->params) {
+                Symbol ps{"", "int", p};
+                ps.param = true;
+                declare(p, ps);
             }
-            if (auto a = dynamic_cast<const AssignStmt*>(st.get())) {
-                const string& name = a->name.lexeme;
-                if (table.find(name) == table.end())
-                    semError(a->name, "Assignment to undeclared variable '" + name + "'.");
+            for (const auto& s : f->body) checkStmt(s.get());
+            fn.clear();
+            return;
+        }
+        if (auto a = dynamic_cast<const AssignStmt*>(st)) {
+            const string& name = a->name.lexeme;
+            if (a->index) {
+                Symbol& sym = checkElement(a->name, a->index.get());
                 checkExpr(a->rhs.get());
+                sym.assigned = true;
+                return;
+            }
+            Symbol* sym = findVar(a->name);
+            if (!sym)
+                semError(a->name, "Assignment to undeclared variable '" + name + "'.");
+            if (sym->size != 0)
+                semError(a->name, "Array '" + name + "' must be indexed.");
+            checkExpr(a->rhs.get());
+            sym->assigned = true;
+            return;
+        }
+        if (auto pr = dynamic_cast<const PrintStmt*>(st)) {
+            checkExpr(pr->expr.get());
+            return;
+        }
+        if (auto cs = dynamic_cast<const CallStmt*>(st)) {
+            checkExpr(cs->call.get());
+            return;
+        }
+        if (auto r = dynamic_cast<const ReturnStmt*>(st)) {
+            if (fn.empty()) semError(r->kw, "'return' is only allowed inside a function.");
+            checkExpr(r->value.get());
+            return;
+        }
+        if (auto blk = dynamic_cast<const BlockStmt*>(st)) {
+            for (const auto& s : blk->stmts) checkStmt(s.get());
+            return;
+        }
+        if (auto is = dynamic_cast<const IfStmt*>(st)) {
+            checkExpr(is->cond.get());
+            checkStmt(is->thenS.get());
+            if (is->elseS) checkStmt(is->elseS.get());
+            return;
+        }
+        if (auto ws = dynamic_cast<const WhileStmt*>(st)) {
+            checkExpr(ws->cond.get());
+            checkStmt(ws->body.get());
+            return;
+        }
+        throw runtime_error("Internal error: Unknown Stmt node in semantic analysis.");
+    }
+
+public:
+    void analyze(const Program& prog) {
+        for (const auto& st : prog.stmts) checkStmt(st.get());
+
+        for (const auto& name : order) {
+            const Symbol& sym = table[name];
+            if (sym.read) continue;
+            if (sym.arity >= 0) {
+                semWarning(sym.decl, "Function '" + name + "' is never called.");
                 continue;
             }
-            if (auto pr = dynamic_cast<const PrintStmt*>(st.get())) {
-                checkExpr(pr->expr.get());
+            if (sym.param) {
+                semWarning(sym.decl, "Parameter '" + name + "' is never used.");
                 continue;
             }
-            throw runtime_error("Internal error: Unknown Stmt node in semantic analysis.");
+            string what = (sym.size ? "Array '" : "Variable '") + name + "'";
+            semWarning(sym.decl, sym.assigned ? what + " is assigned but never used."
+                                              : what + " declared but never used.");
         }
     }
 
     const unordered_map<string, Symbol>& symbols() const { return table; }
     const vector<string>& symbolOrder() const { return order; }
+    const vector<string>& warnings() const { return warns; }
 };
 
 // =========================================================
 // 4) INTERMEDIATE CODE GENERATION (TAC)
 // =========================================================
+// One quadruple per instruction so later passes can rewrite operands without re-parsing text.
+//   Copy    : dst = a
+//   Binary  : dst = a op b          (op is arithmetic or a comparison yielding 0/1)
+//   Print   : print a
+//   Label   : label:
+//   Goto    : goto label
+//   IfFalse : ifFalse a goto label  (falls through when a != 0)
+//   Phi     : dst = phi [v, pred], ...   (SSA form only)
+//   Load    : dst = arr[a]
+//   Store   : arr[a] = b
+//   Check   : check a in arr[0..b-1]   (stops the program when a is out of range; b is a literal)
+//   Param   : param a                  (next argument of the following call)
+//   Call    : dst = call f, b          (b is the argument count, a literal)
+//   Return  : return a                 (only ever the last instruction of a function)
+//   VLoad   : dst = vload arr[a], w    (w consecutive elements from index a; see SLPVectorizer)
+//   VStore  : vstore arr[a], b, w
+//   VBinary : dst = a op b (xw)        (lane-wise +, - or *)
+//   VSplat  : dst = splat a, w         (every lane gets a)
+// Operands are either names (variables / temps) or integer literals. Arrays
+// and functions are not operands: Load/Store/Check/Call keep the name in
+// 'label', so passes that rewrite operands (SSA renaming included) never touch it.
+// Vector instructions only appear after the last pass and name a vector of
+// 'width' lanes with one operand.
+enum class TACKind {
+    Copy, Binary, Print, Label, Goto, IfFalse, Phi, Load, Store, Check, Param, Call, Return,
+    VLoad, VStore, VBinary, VSplat
+};
+
+struct TACInstr {
+    TACKind kind;
+    string dst;
+    string a, b;
+    string op;
+    string label = "";                     // jump target, or the array / function of Load/Store/Check/Call
+    vector<pair<string, string>> phi = {}; // (value, predecessor block label)
+    int width = 1;                         // lanes of a vector instruction
+};
+
+// Each function is its own unit of code with its own names; a function
+// returns through a single 'return' at its very end, so passes never meet
+// an exit in the middle of a CFG. Labels and temps are numbered program-wide.
+struct TACFunction {
+    string name;
+    vector<string> params;
+    vector<TACInstr> code;
+};
+
+struct TACProgram {
+    vector<TACFunction> functions;   // in declaration order
+    vector<TACInstr> main;           // the top-level statements
+
+    size_t size() const {
+        size_t n = main.size();
+        for (const auto& f : functions) n += f.code.size();
+        return n;
+    }
+
+    const TACFunction* find(const string& name) const {
+        for (const auto& f : functions)
+            if (f.name == name) return &f;
+        return nullptr;
+    }
+};
+
+static string tacToString(const TACInstr& in) {
+    switch (in.kind) {
+        case TACKind::Copy:    return in.dst + " = " + in.a;
+        case TACKind::Binary:  return in.dst + " = " + in.a + " " + in.op + " " + in.b;
+        case TACKind::Print:   return "print " + in.a;
+        case TACKind::Label:   return in.label + ":";
+        case TACKind::Goto:    return "goto " + in.label;
+        case TACKind::IfFalse: return "ifFalse " + in.a + " goto " + in.label;
+        case TACKind::Phi: {
+            string s = in.dst + " = phi";
+            for (size_t k = 0; k < in.phi.size(); k++)
+                s += (k ? ", [" : " [") + in.phi[k].first + ", " + in.phi[k].second + "]";
+            return s;
+        }
+        case TACKind::Load:    return in.dst + " = " + in.label + "[" + in.a + "]";
+        case TACKind::Store:   return in.label + "[" + in.a + "] = " + in.b;
+        case TACKind::Check:
+            return "check " + in.a + " in " + in.label + "[0.." + to_string(atoll(in.b.c_str()) - 1) + "]";
+        case TACKind::Param:   return "param " + in.a;
+        case TACKind::Call:    return in.dst + " = call " + in.label + ", " + in.b;
+        case TACKind::Return:  return "return " + in.a;
+        case TACKind::VLoad:   return in.dst + " = vload " + in.label + "[" + in.a + "], " + to_string(in.width);
+        case TACKind::VStore:  return "vstore " + in.label + "[" + in.a + "], " + in.b + ", " + to_string(in.width);
+        case TACKind::VBinary: return in.dst + " = " + in.a + " " + in.op + " " + in.b + " (x" + to_string(in.width) + ")";
+        case TACKind::VSplat:  return in.dst + " = splat " + in.a + ", " + to_string(in.width);
+    }
+    return "";
+}
+
+static bool tacDefines(const TACInstr& in) {
+    return in.kind == TACKind::Copy || in.kind == TACKind::Binary || in.kind == TACKind::Phi ||
+           in.kind == TACKind::Load || in.kind == TACKind::Call || in.kind == TACKind::VLoad ||
+           in.kind == TACKind::VBinary || in.kind == TACKind::VSplat;
+}
+
+static bool tacIsJump(const TACInstr& in) { return in.kind == TACKind::Goto || in.kind == TACKind::IfFalse; }
+
+// Compiler-made names start with characters an identifier cannot, so they never
+// clash with the program's variables: temporaries %tN, vectors %vN, labels .LN.
+static const string TEMP_PREFIX = "%t";
+static const string VEC_PREFIX = "%v";
+static const string LABEL_PREFIX = ".L";
+
+static bool isNameOperand(const string& s) {
+    return !s.empty() && (isalpha((unsigned char)s[0]) || s[0] == '_' || s[0] == '%');
+}
+
+// Calls f on every operand the instruction reads (works on const and mutable instructions).
+template <class Instr, class F>
+static void forEachUse(Instr& in, F f) {
+    switch (in.kind) {
+        case TACKind::Binary:
+        case TACKind::Store:
+        case TACKind::VStore:
+        case TACKind::VBinary: f(in.a); f(in.b); break;
+        case TACKind::Copy:
+        case TACKind::Print:
+        case TACKind::IfFalse:
+        case TACKind::Load:
+        case TACKind::Check:
+        case TACKind::Param:
+        case TACKind::Return:
+        case TACKind::VLoad:
+        case TACKind::VSplat:  f(in.a); break;
+        case TACKind::Phi:     for (auto& arg : in.phi) f(arg.first); break;
+        case TACKind::Label:
+        case TACKind::Goto:
+        case TACKind::Call:    break;
+    }
+}
+
 class TACGenerator {
-    vector<string> code;
+    vector<TACInstr> code;   // unit being generated
+    TACProgram out;
+    unordered_map<string, int32_t> arraySize;
     int tempCounter = 0;
+    int labelCounter = 0;
+    string retVar, retLabel;   // shared exit of the current function, made on the first early return
+
+    string newTemp() {
+        if (g_limits.maxTemps && (size_t)tempCounter >= g_limits.maxTemps)
+            limitError("more than " + to_string(g_limits.maxTemps) + " temporaries (--max-temps).");
+        if (tempCounter % (int)LIMIT_CHECK_EVERY == 0) checkTimeBudget("TAC generation");
+        return TEMP_PREFIX + to_string(++tempCounter);
+    }
+    string newLabel() { return LABEL_PREFIX + to_string(++labelCounter); }
+
+    void emitLabel(const string& l) { code.push_back({TACKind::Label, "", "", "", "", l}); }
+    void emitGoto(const string& l) { code.push_back({TACKind::Goto, "", "", "", "", l}); }
+    void emitIfFalse(const string& c, const string& l) { code.push_back({TACKind::IfFalse, "", c, "", "", l}); }
 
-    string newTemp() { return "t" + to_string(++tempCounter); }
+    // Index operand of arr[index]; semantic analysis already vetted literal
+    // indices, every other index gets a bounds check.
+    string genIndex(const string& arr, const Expr* index) {
+        string i = genExpr(index);
+        if (!dynamic_cast<const NumExpr*>(index))
+            code.push_back({TACKind::Check, "", i, to_string(arraySize.at(arr)), "", arr});
+        return i;
+    }
 
     string genExpr(const Expr* e) {
         if (auto n = dynamic_cast<const NumExpr*>(e)) {
@@ -418,12 +1232,28 @@ class TACGenerator {
         if (auto v = dynamic_cast<const VarExpr*>(e)) {
             return v->tok.lexeme;
         }
+        if (auto ix = dynamic_cast<const IndexExpr*>(e)) {
+            const string& arr = ix->name.lexeme;
+            string i = genIndex(arr, ix->index.get());
+            string t = newTemp();
+            code.push_back({TACKind::Load, t, i, "", "", arr});
+            return t;
+        }
+        if (auto c = dynamic_cast<const CallExpr*>(e)) {
+            //   param a1 ; ... ; param an ; t = call f, n   (arguments evaluated left to right first)
+            vector<string> args;
+            for (const auto& a : c->args) args.push_back(genExpr(a.get()));
+            for (const auto& a : args) code.push_back({TACKind::Param, "", a, "", ""});
+            string t = newTemp();
+            code.push_back({TACKind::Call, t, "", to_string(args.size()), "", c->name.lexeme});
+            return t;
+        }
         if (auto u = dynamic_cast<const UnaryExpr*>(e)) {
             string r = genExpr(u->rhs.get());
             // Keep TAC simple & canonical: t = 0 - r  (for unary minus)
             if (u->op.type == TokenType::MINUS) {
                 string t = newTemp();
-                code.push_back(t + " = 0 - " + r);
+                code.push_back({TACKind::Binary, t, "0", r, "-"});
                 return t;
             }
             // unary plus: just return rhs
@@ -433,95 +1263,3663 @@ class TACGenerator {
             string l = genExpr(b->lhs.get());
             string r = genExpr(b->rhs.get());
             string t = newTemp();
-            code.push_back(t + " = " + l + " " + b->op.lexeme + " " + r);
+            code.push_back({TACKind::Binary, t, l, r, b->op.lexeme});
             return t;
         }
         throw runtime_error("Internal error: Unknown Expr node in TAC generation.");
     }
 
-public:
-    vector<string> generate(const Program& prog) {
-        code.clear();
-        tempCounter = 0;
-
-        for (const auto& st : prog.stmts) {
-            if (dynamic_cast<const DeclStmt*>(st.get())) {
-                // For this lab compiler, declarations do not generate TAC.
-                continue;
-            }
-            if (auto a = dynamic_cast<const AssignStmt*>(st.get())) {
+    void genStmt(const Stmt* st) {
+        if (auto d = dynamic_cast<const DeclStmt*>(st)) {
+            // For this lab compiler, declarations do not generate TAC (arrays start zeroed).
+            if (d->isArray()) arraySize[d->name.lexeme] = (int32_t)stoll(d->size.lexeme);
+            return;
+        }
+        if (auto a = dynamic_cast<const AssignStmt*>(st)) {
+            if (a->index) {
+                const string& arr = a->name.lexeme;
+                string i = genIndex(arr, a->index.get());
                 string rhs = genExpr(a->rhs.get());
-                code.push_back(a->name.lexeme + " = " + rhs);
-                continue;
+                code.push_back({TACKind::Store, "", i, rhs, "", arr});
+                return;
             }
-            if (auto pr = dynamic_cast<const PrintStmt*>(st.get())) {
-                string x = genExpr(pr->expr.get());
-                code.push_back("print " + x);
-                continue;
+            string rhs = genExpr(a->rhs.get());
+            code.push_back({TACKind::Copy, a->name.lexeme, rhs, "", ""});
+            return;
+        }
+        if (auto pr = dynamic_cast<const PrintStmt*>(st)) {
+            string x = genExpr(pr->expr.get());
+            code.push_back({TACKind::Print, "", x, "", ""});
+            return;
+        }
+        if (auto cs = dynamic_cast<const CallStmt*>(st)) {
+            genExpr(cs->call.get());
+            return;
+        }
+        if (auto r = dynamic_cast<const ReturnStmt*>(st)) {
+            //   rv = e ; goto Lret    (Lret: return rv  closes the function)
+            string v = genExpr(r->value.get());
+            if (retVar.empty()) { retVar = newTemp(); retLabel = newLabel(); }
+            code.push_back({TACKind::Copy, retVar, v, "", ""});
+            emitGoto(retLabel);
+            return;
+        }
+        if (auto f = dynamic_cast<const FuncDecl*>(st)) {
+            genFunction(f);
+            return;
+        }
+        if (auto blk = dynamic_cast<const BlockStmt*>(st)) {
+            for (const auto& s : blk->stmts) genStmt(s.get());
+            return;
+        }
+        if (auto is = dynamic_cast<const IfStmt*>(st)) {
+            //   ifFalse c goto Lelse ; then ; goto Lend ; Lelse: else ; Lend:
+            string c = genExpr(is->cond.get());
+            string lElse = newLabel();
+            emitIfFalse(c, lElse);
+            genStmt(is->thenS.get());
+            if (is->elseS) {
+                string lEnd = newLabel();
+                emitGoto(lEnd);
+                emitLabel(lElse);
+                genStmt(is->elseS.get());
+                emitLabel(lEnd);
+            } else {
+                emitLabel(lElse);
             }
-            throw runtime_error("Internal error: Unknown Stmt node in TAC generation.");
+            return;
+        }
+        if (auto ws = dynamic_cast<const WhileStmt*>(st)) {
+            //   Lbegin: ifFalse c goto Lend ; body ; goto Lbegin ; Lend:
+            string lBegin = newLabel(), lEnd = newLabel();
+            emitLabel(lBegin);
+            string c = genExpr(ws->cond.get());
+            emitIfFalse(c, lEnd);
+            genStmt(ws->body.get());
+            emitGoto(lBegin);
+            emitLabel(lEnd);
+            return;
+        }
+        throw runtime_error("Internal error: Unknown Stmt node in TAC generation.");
+    }
+
+    // A trailing 'return e' returns directly; earlier returns jump to a shared
+    // exit. Falling off the end returns 0.
+    void genFunction(const FuncDecl* f) {
+        vector<TACInstr> outer;
+        outer.swap(code);
+        retVar.clear();
+        retLabel.clear();
+
+        const auto& body = f->body;
+        auto last = body.empty() ? nullptr : dynamic_cast<const ReturnStmt*>(body.back().get());
+        for (size_t k = 0; k + (last ? 1 : 0) < body.size(); k++) genStmt(body[k].get());
+        string v = last ? genExpr(last->value.get()) : "0";
+        if (!retVar.empty()) {
+            code.push_back({TACKind::Copy, retVar, v, "", ""});
+            emitLabel(retLabel);
+            v = retVar;
         }
+        code.push_back({TACKind::Return, "", v, "", ""});
+
+        TACFunction fn{f->name.lexeme, {}, {}};
+        for (const auto& p : f->params) fn.params.push_back(p.lexeme);
+        fn.code.swap(code);
+        out.functions.push_back(std::move(fn));
+        code.swap(outer);
+    }
+
+public:
+    TACProgram generate(const Program& prog) {
+        AllocCategoryScope tag(AllocCategory::TACStrings);
+        code.clear();
+        out = TACProgram{};
+        arraySize.clear();
+        tempCounter = 0;
+        labelCounter = 0;
 
-        return code;
+        for (const auto& st : prog.stmts) genStmt(st.get());
+
+        out.main.swap(code);
+        return std::move(out);
     }
 };
 
 // =========================================================
-// OUTPUT HELPERS (Exam format)
+// 4b) CONTROL FLOW GRAPH (basic blocks)
 // =========================================================
-static void printTokens(const vector<Token>& toks) {
-    cout << "TOKENS:\n";
-    for (const auto& tk : toks) {
-        if (tk.type == TokenType::END) break; // keep output clean
-        cout << left << setw(10) << tk.lexeme << " " << tokenCategory(tk.type) << "\n";
-    }
-    cout << "\n";
-}
+// A block starts at a label or after a jump and ends with at most one jump.
+// Blocks keep their layout order: a block without a trailing 'goto' falls
+// through to the next one, and an 'ifFalse' falls through when not taken.
+struct BasicBlock {
+    string label;            // empty for an unlabeled fall-through block
+    vector<TACInstr> code;   // phis first, jump (if any) last; no Label instruction
+    vector<size_t> succ, pred;
+};
 
-static void printSymbolTable(const SemanticAnalyzer& sem) {
-    cout << "SYMBOL TABLE:\n";
-    cout << left << setw(10) << "Name" << "Type\n";
-    for (const auto& name : sem.symbolOrder()) {
-        cout << left << setw(10) << name << "int\n";
+// Highest N among names "<prefix>N" (or SSA versions "<prefix>N.k"), so passes can mint fresh ones.
+static int maxNumbered(const vector<TACInstr>& code, const string& prefix) {
+    int best = 0;
+    const size_t p = prefix.size();
+    auto see = [&](const string& x) {
+        if (x.size() <= p || x.compare(0, p, prefix) != 0 || !isdigit((unsigned char)x[p])) return;
+        size_t k = p;
+        while (k < x.size() && isdigit((unsigned char)x[k])) k++;
+        if (k == x.size() || x[k] == '.') best = max(best, atoi(x.c_str() + p));
+    };
+    for (const auto& in : code) {
+        see(in.dst);
+        see(in.label);
+        forEachUse(in, [&](const string& x) { see(x); });
     }
-    cout << "\n";
+    return best;
 }
 
-static void printTAC(const vector<string>& tac) {
-    cout << "INTERMEDIATE CODE (TAC):\n";
-    for (const auto& line : tac) cout << line << "\n";
+class CFG {
+    unordered_map<string, size_t> byLabel;
+    int nextLabel = 0;
+
+public:
+    vector<BasicBlock> blocks;   // blocks[0] is the entry and never has predecessors
+
+    explicit CFG(vector<TACInstr> code) {
+        nextLabel = maxNumbered(code, LABEL_PREFIX);
+        blocks.emplace_back();
+        bool afterJump = false;
+        for (auto& in : code) {
+            if (in.kind == TACKind::Label) {
+                blocks.emplace_back();
+                blocks.back().label = in.label;
+                afterJump = false;
+                continue;
+            }
+            if (afterJump) blocks.emplace_back();
+            afterJump = tacIsJump(in);
+            blocks.back().code.push_back(std::move(in));
+        }
+        rebuildEdges();
+    }
+
+    size_t blockOf(const string& label) const {
+        auto it = byLabel.find(label);
+        if (it == byLabel.end()) throw runtime_error("Internal error: jump to unknown label '" + label + "'.");
+        return it->second;
+    }
+
+    void rebuildEdges() {
+        byLabel.clear();
+        for (size_t b = 0; b < blocks.size(); b++) {
+            blocks[b].succ.clear();
+            blocks[b].pred.clear();
+            if (!blocks[b].label.empty()) byLabel[blocks[b].label] = b;
+        }
+        for (size_t b = 0; b < blocks.size(); b++) {
+            auto& bb = blocks[b];
+            bool fallsThrough = bb.code.empty() || bb.code.back().kind != TACKind::Goto;
+            if (fallsThrough && b + 1 < blocks.size()) bb.succ.push_back(b + 1);
+            if (!bb.code.empty() && tacIsJump(bb.code.back())) {
+                size_t t = blockOf(bb.code.back().label);
+                if (find(bb.succ.begin(), bb.succ.end(), t) == bb.succ.end()) bb.succ.push_back(t);
+            }
+            for (size_t s : bb.succ) blocks[s].pred.push_back(b);
+        }
+    }
+
+    string freshLabel() { return LABEL_PREFIX + to_string(++nextLabel); }
+
+    // SSA needs a name for every block (phi operands refer to predecessors by label).
+    void labelAll() {
+        for (auto& bb : blocks)
+            if (bb.label.empty()) bb.label = freshLabel();
+        rebuildEdges();
+    }
+
+    // Drops blocks the entry cannot reach. Such a block is never the
+    // fall-through target of a reachable one, so layout stays valid.
+    void removeUnreachable() {
+        vector<bool> seen(blocks.size(), false);
+        vector<size_t> work{0};
+        seen[0] = true;
+        while (!work.empty()) {
+            size_t b = work.back();
+            work.pop_back();
+            for (size_t s : blocks[b].succ)
+                if (!seen[s]) { seen[s] = true; work.push_back(s); }
+        }
+        vector<BasicBlock> kept;
+        for (size_t b = 0; b < blocks.size(); b++)
+            if (seen[b]) kept.push_back(std::move(blocks[b]));
+        blocks.swap(kept);
+        rebuildEdges();
+
+        // Phi operands coming from removed predecessors are gone too.
+        for (auto& bb : blocks) {
+            unordered_set<string> preds;
+            for (size_t pr : bb.pred) preds.insert(blocks[pr].label);
+            for (auto& in : bb.code) {
+                if (in.kind != TACKind::Phi) break;
+                in.phi.erase(remove_if(in.phi.begin(), in.phi.end(),
+                                       [&](const pair<string, string>& a) { return !preds.count(a.second); }),
+                             in.phi.end());
+            }
+        }
+    }
+
+    vector<size_t> reversePostorder() const {
+        vector<size_t> post;
+        vector<bool> seen(blocks.size(), false);
+        vector<pair<size_t, size_t>> stack{{0, 0}};   // (block, next successor to visit)
+        seen[0] = true;
+        while (!stack.empty()) {
+            auto& [b, k] = stack.back();
+            if (k < blocks[b].succ.size()) {
+                size_t s = blocks[b].succ[k++];
+                if (!seen[s]) { seen[s] = true; stack.push_back({s, 0}); }
+            } else {
+                post.push_back(b);
+                stack.pop_back();
+            }
+        }
+        reverse(post.begin(), post.end());
+        return post;
+    }
+
+    // Cooper-Harvey-Kennedy iterative dominators. idom[entry] == entry;
+    // unreachable blocks get SIZE_MAX.
+    vector<size_t> immediateDominators() const {
+        const size_t none = SIZE_MAX;
+        vector<size_t> rpo = reversePostorder(), order(blocks.size(), none), idom(blocks.size(), none);
+        for (size_t k = 0; k < rpo.size(); k++) order[rpo[k]] = k;
+        idom[0] = 0;
+
+        auto intersect = [&](size_t a, size_t b) {
+            while (a != b) {
+                while (order[a] > order[b]) a = idom[a];
+                while (order[b] > order[a]) b = idom[b];
+            }
+            return a;
+        };
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t k = 1; k < rpo.size(); k++) {
+                size_t b = rpo[k], nd = none;
+                for (size_t p : blocks[b].pred) {
+                    if (idom[p] == none) continue;
+                    nd = (nd == none) ? p : intersect(p, nd);
+                }
+                if (nd != idom[b]) { idom[b] = nd; changed = true; }
+            }
+        }
+        return idom;
+    }
+
+    static vector<vector<size_t>> domChildren(const vector<size_t>& idom) {
+        vector<vector<size_t>> kids(idom.size());
+        for (size_t b = 1; b < idom.size(); b++)
+            if (idom[b] != SIZE_MAX) kids[idom[b]].push_back(b);
+        return kids;
+    }
+
+    vector<TACInstr> flatten() {
+        vector<TACInstr> out;
+        for (auto& bb : blocks) {
+            if (!bb.label.empty()) out.push_back({TACKind::Label, "", "", "", "", bb.label});
+            for (auto& in : bb.code) out.push_back(std::move(in));
+        }
+        return out;
+    }
+};
+
+// Removes jumps to the very next instruction; either way control ends up there.
+static void dropJumpsToNext(vector<TACInstr>& code) {
+    vector<TACInstr> out;
+    out.reserve(code.size());
+    for (size_t k = 0; k < code.size(); k++) {
+        const TACInstr& in = code[k];
+        if (tacIsJump(in) && k + 1 < code.size() && code[k + 1].kind == TACKind::Label && code[k + 1].label == in.label)
+            continue;
+        out.push_back(std::move(code[k]));
+    }
+    code.swap(out);
+}
+
+// Removes labels no jump or phi refers to (e.g. the ones SSA invented).
+static void dropUnusedLabels(vector<TACInstr>& code) {
+    unordered_set<string> used;
+    for (const auto& in : code) {
+        if (tacIsJump(in)) used.insert(in.label);
+        for (const auto& arg : in.phi) used.insert(arg.second);
+    }
+    code.erase(remove_if(code.begin(), code.end(),
+                         [&](const TACInstr& in) { return in.kind == TACKind::Label && !used.count(in.label); }),
+               code.end());
+}
+
+// =========================================================
+// 4c) MEMORY FOOTPRINT (bytes held by each data structure)
+// =========================================================
+// Computed from sizes and capacities: the objects themselves, vector buffers
+// and string buffers too long for the inline small-string storage. Allocator
+// headers and padding are not counted, so these are lower bounds.
+static size_t heapBytes(const string& s) {
+    static const size_t inlineCapacity = string().capacity();
+    return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+template <class T>
+static size_t bufferBytes(const vector<T>& v) { return v.capacity() * sizeof(T); }
+
+static size_t footprint(const vector<Token>& toks) {
+    size_t n = bufferBytes(toks);
+    for (const auto& t : toks) n += heapBytes(t.lexeme);
+    return n;
+}
+
+static size_t footprint(const Expr* e) {
+    if (!e) return 0;
+    if (auto n = dynamic_cast<const NumExpr*>(e)) return sizeof(NumExpr) + heapBytes(n->tok.lexeme);
+    if (auto v = dynamic_cast<const VarExpr*>(e)) return sizeof(VarExpr) + heapBytes(v->tok.lexeme);
+    if (auto x = dynamic_cast<const IndexExpr*>(e))
+        return sizeof(IndexExpr) + heapBytes(x->name.lexeme) + footprint(x->index.get());
+    if (auto c = dynamic_cast<const CallExpr*>(e)) {
+        size_t n = sizeof(CallExpr) + heapBytes(c->name.lexeme) + bufferBytes(c->args);
+        for (const auto& a : c->args) n += footprint(a.get());
+        return n;
+    }
+    if (auto u = dynamic_cast<const UnaryExpr*>(e)) return sizeof(UnaryExpr) + heapBytes(u->op.lexeme) + footprint(u->rhs.get());
+    if (auto b = dynamic_cast<const BinaryExpr*>(e))
+        return sizeof(BinaryExpr) + heapBytes(b->op.lexeme) + footprint(b->lhs.get()) + footprint(b->rhs.get());
+    return sizeof(Expr);
+}
+
+static size_t footprint(const Stmt* s) {
+    if (!s) return 0;
+    if (auto d = dynamic_cast<const DeclStmt*>(s)) return sizeof(DeclStmt) + heapBytes(d->name.lexeme) + heapBytes(d->size.lexeme);
+    if (auto a = dynamic_cast<const AssignStmt*>(s))
+        return sizeof(AssignStmt) + heapBytes(a->name.lexeme) + footprint(a->index.get()) + footprint(a->rhs.get());
+    if (auto p = dynamic_cast<const PrintStmt*>(s)) return sizeof(PrintStmt) + heapBytes(p->kw.lexeme) + footprint(p->expr.get());
+    if (auto r = dynamic_cast<const ReturnStmt*>(s)) return sizeof(ReturnStmt) + heapBytes(r->kw.lexeme) + footprint(r->value.get());
+    if (auto c = dynamic_cast<const CallStmt*>(s)) return sizeof(CallStmt) + footprint(c->call.get());
+    if (auto f = dynamic_cast<const FuncDecl*>(s)) {
+        size_t n = sizeof(FuncDecl) + heapBytes(f->name.lexeme) + bufferBytes(f->params) + bufferBytes(f->body);
+        for (const auto& t : f->params) n += heapBytes(t.lexeme);
+        for (const auto& x : f->body) n += footprint(x.get());
+        return n;
+    }
+    if (auto b = dynamic_cast<const BlockStmt*>(s)) {
+        size_t n = sizeof(BlockStmt) + bufferBytes(b->stmts);
+        for (const auto& x : b->stmts) n += footprint(x.get());
+        return n;
+    }
+    if (auto i = dynamic_cast<const IfStmt*>(s))
+        return sizeof(IfStmt) + heapBytes(i->kw.lexeme) + footprint(i->cond.get()) + footprint(i->thenS.get()) +
+               footprint(i->elseS.get());
+    if (auto w = dynamic_cast<const WhileStmt*>(s))
+        return sizeof(WhileStmt) + heapBytes(w->kw.lexeme) + footprint(w->cond.get()) + footprint(w->body.get());
+    return sizeof(Stmt);
+}
+
+static size_t footprint(const Program& prog) {
+    size_t n = bufferBytes(prog.stmts);
+    for (const auto& s : prog.stmts) n += footprint(s.get());
+    return n;
+}
+
+// A node of unordered_map holds the pair, the next pointer and the cached hash.
+static size_t footprint(const unordered_map<string, Symbol>& table) {
+    size_t n = table.bucket_count() * sizeof(void*);
+    for (const auto& kv : table) {
+        n += sizeof(kv) + sizeof(void*) + sizeof(size_t) + heapBytes(kv.first);
+        n += heapBytes(kv.second.name) + heapBytes(kv.second.type) + heapBytes(kv.second.decl.lexeme);
+    }
+    return n;
+}
+
+static size_t footprint(const vector<string>& names) {
+    size_t n = bufferBytes(names);
+    for (const auto& s : names) n += heapBytes(s);
+    return n;
+}
+
+static size_t footprint(const vector<TACInstr>& code) {
+    size_t n = bufferBytes(code);
+    for (const auto& in : code) {
+        n += heapBytes(in.dst) + heapBytes(in.a) + heapBytes(in.b) + heapBytes(in.op) + heapBytes(in.label);
+        n += bufferBytes(in.phi);
+        for (const auto& ph : in.phi) n += heapBytes(ph.first) + heapBytes(ph.second);
+    }
+    return n;
+}
+
+static size_t footprint(const TACProgram& prog) {
+    size_t n = bufferBytes(prog.functions) + footprint(prog.main);
+    for (const auto& f : prog.functions) n += heapBytes(f.name) + footprint(f.params) + footprint(f.code);
+    return n;
+}
+
+// Peak resident set size of the process in bytes, 0 where unknown.
+static size_t peakRSSBytes() {
+#ifdef MINI_LINUX
+    rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) == 0) return (size_t)ru.ru_maxrss * 1024;   // kilobytes on Linux
+#endif
+    return 0;
+}
+
+// =========================================================
+// 5) CODE OPTIMIZATION (Constant Propagation)
+// =========================================================
+// Integer semantics used whenever the compiler evaluates code itself:
+// 32-bit two's complement with wrap-around, division truncates toward zero.
+// Division by zero and INT_MIN / -1 are never folded; they are left for run time.
+static bool parseIntLiteral(const string& s, int32_t& out) {
+    if (s.empty()) return false;
+    size_t k = (s[0] == '-') ? 1 : 0;
+    if (k == s.size() || !isdigit((unsigned char)s[k])) return false;
+    errno = 0;
+    char* end = nullptr;
+    long long v = strtoll(s.c_str(), &end, 10);
+    if (errno != 0 || *end != '\0' || v < INT32_MIN || v > INT32_MAX) return false;
+    out = (int32_t)v;
+    return true;
+}
+
+static bool foldBinary(const string& op, int32_t l, int32_t r, int32_t& out) {
+    uint32_t ul = (uint32_t)l, ur = (uint32_t)r;
+    if (op == "+") { out = (int32_t)(ul + ur); return true; }
+    if (op == "-") { out = (int32_t)(ul - ur); return true; }
+    if (op == "*") { out = (int32_t)(ul * ur); return true; }
+    if (op == "/") {
+        if (r == 0 || (l == INT32_MIN && r == -1)) return false;
+        out = l / r;
+        return true;
+    }
+    if (op == "<")  { out = l < r;  return true; }
+    if (op == "<=") { out = l <= r; return true; }
+    if (op == ">")  { out = l > r;  return true; }
+    if (op == ">=") { out = l >= r; return true; }
+    if (op == "==") { out = l == r; return true; }
+    if (op == "!=") { out = l != r; return true; }
+    return false;
+}
+
+// Forward pass over the TAC: remembers which names currently hold a known
+// constant, substitutes those constants into later uses and folds the
+// resulting constant expressions. Knowledge is only carried within a basic
+// block (it is forgotten at every label, where control flow may merge).
+// A constant definition that no instruction reads any more is dropped
+// afterwards, and so is a bounds check whose index became a constant in range.
+class ConstantPropagator {
+    unordered_map<string, int32_t> known;
+
+    void substitute(string& operand) const {
+        auto it = known.find(operand);
+        if (it != known.end()) operand = to_string(it->second);
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        known.clear();
+
+        for (auto& in : code) {
+            if (in.kind == TACKind::Label || in.kind == TACKind::Goto) {
+                known.clear();
+                continue;
+            }
+            forEachUse(in, [&](string& x) { substitute(x); });
+
+            if (in.kind == TACKind::Binary) {
+                int32_t l, r, v;
+                if (parseIntLiteral(in.a, l) && parseIntLiteral(in.b, r) && foldBinary(in.op, l, r, v)) {
+                    in = {TACKind::Copy, in.dst, to_string(v), "", ""};
+                }
+            }
+
+            if (in.kind == TACKind::Copy) {
+                int32_t v;
+                if (parseIntLiteral(in.a, v)) known[in.dst] = v;
+                else known.erase(in.dst);
+            } else if (tacDefines(in)) {
+                known.erase(in.dst);
+            }
+        }
+
+        unordered_map<string, int> reads;
+        for (const auto& in : code)
+            forEachUse(in, [&](const string& x) { reads[x]++; });
+
+        vector<TACInstr> kept;
+        kept.reserve(code.size());
+        for (auto& in : code) {
+            int32_t v;
+            if (in.kind == TACKind::Copy && parseIntLiteral(in.a, v) && reads.find(in.dst) == reads.end())
+                continue;
+            if (in.kind == TACKind::Check && parseIntLiteral(in.a, v) && v >= 0 && v < atoi(in.b.c_str()))
+                continue;
+            kept.push_back(std::move(in));
+        }
+        code.swap(kept);
+    }
+};
+
+// Live-in / live-out sets of every block, by the usual backward iteration to a fixed point.
+struct Liveness {
+    vector<unordered_set<string>> in, out;
+
+    explicit Liveness(const CFG& cfg) : in(cfg.blocks.size()), out(cfg.blocks.size()) {
+        size_t n = cfg.blocks.size();
+        vector<unordered_set<string>> use(n), def(n);
+        for (size_t b = 0; b < n; b++) {
+            for (const auto& ins : cfg.blocks[b].code) {
+                forEachUse(ins, [&](const string& x) { if (isNameOperand(x) && !def[b].count(x)) use[b].insert(x); });
+                if (tacDefines(ins)) def[b].insert(ins.dst);
+            }
+        }
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (size_t b = n; b-- > 0;) {
+                for (size_t s : cfg.blocks[b].succ)
+                    for (const auto& x : in[s])
+                        out[b].insert(x);
+                size_t before = in[b].size();
+                for (const auto& x : use[b]) in[b].insert(x);
+                for (const auto& x : out[b])
+                    if (!def[b].count(x)) in[b].insert(x);
+                if (in[b].size() != before) changed = true;
+            }
+        }
+    }
+};
+
+// Backward liveness over the CFG. Prints, array stores, bounds checks, calls
+// and returns are the observable effects (and branch conditions decide which of them run), so
+// a definition whose name is not live at that point (never read again, or
+// overwritten before the next read) is removed together with the temps that
+// only fed it.
+class DeadCodeEliminator {
+public:
+    void run(vector<TACInstr>& code) {
+        CFG cfg(std::move(code));
+        Liveness lv(cfg);
+
+        for (size_t b = 0; b < cfg.blocks.size(); b++) {
+            auto& bc = cfg.blocks[b].code;
+            unordered_set<string> live = lv.out[b];
+            vector<bool> keep(bc.size(), true);
+            for (size_t k = bc.size(); k-- > 0;) {
+                const TACInstr& in = bc[k];
+                if (tacDefines(in)) {
+                    bool wanted = live.erase(in.dst) > 0;
+                    if (!wanted && in.kind != TACKind::Call) { keep[k] = false; continue; }
+                }
+                forEachUse(in, [&](const string& x) { if (isNameOperand(x)) live.insert(x); });
+            }
+            size_t w = 0;
+            for (size_t k = 0; k < bc.size(); k++)
+                if (keep[k]) {
+                    if (w != k) bc[w] = std::move(bc[k]);
+                    w++;
+                }
+            bc.resize(w);
+        }
+        code = cfg.flatten();
+    }
+};
+
+// =========================================================
+// 6) SSA FORM + SSA OPTIMIZATIONS
+// =========================================================
+// SSA reuses TACInstr: every definition gets a fresh version "name.N" ('.' can
+// not appear in source identifiers, so versions never clash with user names).
+// A read that no definition reaches refers to "name.0", the value on entry.
+// Where definitions of a name merge, a phi picks the version by predecessor.
+static string ssaBase(const string& name) {
+    size_t dot = name.rfind('.');
+    return dot == string::npos ? name : name.substr(0, dot);
+}
+
+// Cytron et al.: phis for every name that is live across blocks ("semi-pruned")
+// at the iterated dominance frontier of its definitions, then renaming along
+// a preorder walk of the dominator tree.
+class SSABuilder {
+public:
+    void run(vector<TACInstr>& code) {
+        CFG cfg(std::move(code));
+        cfg.removeUnreachable();
+        cfg.labelAll();
+        size_t n = cfg.blocks.size();
+        vector<size_t> idom = cfg.immediateDominators();
+        vector<vector<size_t>> kids = CFG::domChildren(idom);
+
+        // Names read in some block before being written there need phis; block-local temps do not.
+        unordered_map<string, vector<size_t>> defSites;
+        unordered_set<string> global;
+        for (size_t b = 0; b < n; b++) {
+            unordered_set<string> written;
+            for (const auto& in : cfg.blocks[b].code) {
+                forEachUse(in, [&](const string& x) { if (isNameOperand(x) && !written.count(x)) global.insert(x); });
+                if (tacDefines(in) && written.insert(in.dst).second) defSites[in.dst].push_back(b);
+            }
+        }
+
+        vector<vector<size_t>> frontier(n);
+        for (size_t b = 0; b < n; b++) {
+            if (cfg.blocks[b].pred.size() < 2) continue;
+            for (size_t p : cfg.blocks[b].pred)
+                for (size_t r = p; r != idom[b]; r = idom[r])
+                    if (find(frontier[r].begin(), frontier[r].end(), b) == frontier[r].end())
+                        frontier[r].push_back(b);
+        }
+
+        vector<string> names(global.begin(), global.end());
+        sort(names.begin(), names.end());
+        vector<vector<string>> phisAt(n);
+        for (const auto& name : names) {
+            auto ds = defSites.find(name);
+            if (ds == defSites.end()) continue;
+            vector<bool> hasPhi(n, false), queued(n, false);
+            vector<size_t> work = ds->second;
+            for (size_t b : work) queued[b] = true;
+            while (!work.empty()) {
+                size_t b = work.back();
+                work.pop_back();
+                for (size_t d : frontier[b]) {
+                    if (hasPhi[d]) continue;
+                    hasPhi[d] = true;
+                    phisAt[d].push_back(name);
+                    if (!queued[d]) { queued[d] = true; work.push_back(d); }
+                }
+            }
+        }
+        for (size_t b = 0; b < n; b++) {
+            vector<TACInstr> phis;
+            for (const auto& name : phisAt[b]) phis.push_back({TACKind::Phi, name, "", "", ""});
+            auto& bc = cfg.blocks[b].code;
+            bc.insert(bc.begin(), phis.begin(), phis.end());
+        }
+
+        // Rename; explicit stack because the dominator tree can be as deep as the program is long.
+        unordered_map<string, vector<string>> current;
+        unordered_map<string, int> nextVersion;
+        auto top = [&](const string& x) {
+            auto it = current.find(x);
+            return (it == current.end() || it->second.empty()) ? x + ".0" : it->second.back();
+        };
+
+        struct Frame { size_t block, nextKid; vector<string> pushed; };
+        vector<Frame> stack;
+        stack.push_back({0, 0, {}});
+        bool entering = true;
+        while (!stack.empty()) {
+            if (entering) {
+                Frame& f = stack.back();
+                auto& bb = cfg.blocks[f.block];
+                for (auto& in : bb.code) {
+                    if (in.kind != TACKind::Phi)
+                        forEachUse(in, [&](string& x) { if (isNameOperand(x)) x = top(x); });
+                    if (tacDefines(in)) {
+                        string v = in.dst + "." + to_string(++nextVersion[in.dst]);
+                        current[in.dst].push_back(v);
+                        f.pushed.push_back(in.dst);
+                        in.dst = v;
+                    }
+                }
+                for (size_t sIdx : bb.succ) {
+                    for (auto& in : cfg.blocks[sIdx].code) {
+                        if (in.kind != TACKind::Phi) break;
+                        in.phi.push_back({top(ssaBase(in.dst)), bb.label});
+                    }
+                }
+            }
+            Frame& f = stack.back();
+            if (f.nextKid < kids[f.block].size()) {
+                size_t k = kids[f.block][f.nextKid++];
+                stack.push_back({k, 0, {}});
+                entering = true;
+            } else {
+                for (const auto& name : f.pushed) current[name].pop_back();
+                stack.pop_back();
+                entering = false;
+            }
+        }
+
+        code = cfg.flatten();
+    }
+};
+
+// Leaves SSA. Critical edges into blocks with phis get a block of their own,
+// then each phi becomes a copy at the end of every predecessor. The copies on
+// one edge act in parallel, so a source that another copy overwrites is saved
+// to a temp first. Finally the versions of a name are mapped back to the name
+// itself unless they interfere (one is live where the other is defined); a
+// version that would clash keeps its "name.N" spelling as a separate variable.
+class SSADestructor {
+    int nextTemp = 0;
+
+    string freshTemp() { return TEMP_PREFIX + to_string(++nextTemp) + ".1"; }
+
+    static size_t phiCount(const BasicBlock& bb) {
+        size_t k = 0;
+        while (k < bb.code.size() && bb.code[k].kind == TACKind::Phi) k++;
+        return k;
+    }
+
+    static void relabelPhiArgs(BasicBlock& bb, const string& from, const string& to) {
+        for (size_t k = 0; k < phiCount(bb); k++)
+            for (auto& arg : bb.code[k].phi)
+                if (arg.second == from) arg.second = to;
+    }
+
+    void splitCriticalEdges(CFG& cfg) {
+        vector<BasicBlock> layout, tail;
+        size_t n = cfg.blocks.size();
+        for (size_t p = 0; p < n; p++) {
+            BasicBlock& pb = cfg.blocks[p];
+            bool critical = pb.succ.size() > 1;
+            string fallLabel, splitFall;
+            if (critical) {
+                for (size_t b : pb.succ) {
+                    BasicBlock& bb = cfg.blocks[b];
+                    if (bb.pred.size() < 2 || phiCount(bb) == 0) continue;
+                    string e = cfg.freshLabel();
+                    relabelPhiArgs(bb, pb.label, e);
+                    if (b == p + 1 && pb.code.back().label != bb.label) {
+                        splitFall = e;      // not-taken edge: new block sits between p and b
+                    } else {
+                        pb.code.back().label = e;   // taken edge: new block at the end jumps on to b
+                        BasicBlock eb;
+                        eb.label = e;
+                        eb.code.push_back({TACKind::Goto, "", "", "", "", bb.label});
+                        tail.push_back(std::move(eb));
+                    }
+                }
+            }
+            layout.push_back(std::move(pb));
+            if (!splitFall.empty()) {
+                BasicBlock eb;
+                eb.label = splitFall;
+                layout.push_back(std::move(eb));
+            }
+        }
+        if (!tail.empty()) {
+            // The old last block must not fall into the appended edge blocks.
+            BasicBlock& last = layout.back();
+            if (last.code.empty() || last.code.back().kind != TACKind::Goto) {
+                BasicBlock exitBlock;
+                exitBlock.label = cfg.freshLabel();
+                last.code.push_back({TACKind::Goto, "", "", "", "", exitBlock.label});
+                tail.push_back(std::move(exitBlock));
+            }
+            for (auto& eb : tail) layout.push_back(std::move(eb));
+        }
+        cfg.blocks.swap(layout);
+        cfg.rebuildEdges();
+    }
+
+    vector<TACInstr> parallelCopies(vector<pair<string, string>> moves) {   // (dst, src)
+        unordered_set<string> dsts;
+        for (const auto& m : moves) dsts.insert(m.first);
+        vector<TACInstr> out;
+        for (auto& m : moves) {
+            if (m.first == m.second || !dsts.count(m.second)) continue;
+            string t = freshTemp();
+            out.push_back({TACKind::Copy, t, m.second, "", ""});
+            m.second = t;
+        }
+        for (const auto& m : moves)
+            if (m.first != m.second) out.push_back({TACKind::Copy, m.first, m.second, "", ""});
+        return out;
+    }
+
+    void eliminatePhis(CFG& cfg) {
+        for (auto& bb : cfg.blocks) {
+            size_t nPhi = phiCount(bb);
+            if (nPhi == 0) continue;
+            for (size_t p : bb.pred) {
+                BasicBlock& pb = cfg.blocks[p];
+                vector<pair<string, string>> moves;
+                for (size_t k = 0; k < nPhi; k++)
+                    for (const auto& arg : bb.code[k].phi)
+                        if (arg.second == pb.label) moves.push_back({bb.code[k].dst, arg.first});
+                vector<TACInstr> copies = parallelCopies(moves);
+                if (copies.empty()) continue;
+
+                auto& pc = pb.code;
+                bool jumpLast = !pc.empty() && tacIsJump(pc.back());
+                if (jumpLast && pc.back().kind == TACKind::IfFalse) {
+                    // Both arms reach bb; keep the condition's value safe from the copies.
+                    string t = freshTemp();
+                    copies.insert(copies.begin(), {TACKind::Copy, t, pc.back().a, "", ""});
+                    pc.back().a = t;
+                }
+                pc.insert(jumpLast ? pc.end() - 1 : pc.end(), copies.begin(), copies.end());
+            }
+            bb.code.erase(bb.code.begin(), bb.code.begin() + (long)nPhi);
+        }
+    }
+
+    void renameVersions(vector<TACInstr>& code) {
+        CFG cfg(code);
+        Liveness lv(cfg);
+
+        // Interference among versions of the same base name. A copy's source
+        // does not interfere with its destination: they hold the same value.
+        unordered_map<string, unordered_set<string>> clash;
+        for (size_t b = 0; b < cfg.blocks.size(); b++) {
+            unordered_map<string, unordered_set<string>> liveByBase;
+            for (const auto& x : lv.out[b]) liveByBase[ssaBase(x)].insert(x);
+            const auto& bc = cfg.blocks[b].code;
+            for (size_t k = bc.size(); k-- > 0;) {
+                const TACInstr& in = bc[k];
+                if (tacDefines(in)) {
+                    auto& same = liveByBase[ssaBase(in.dst)];
+                    for (const auto& other : same) {
+                        if (other == in.dst || (in.kind == TACKind::Copy && other == in.a)) continue;
+                        clash[in.dst].insert(other);
+                        clash[other].insert(in.dst);
+                    }
+                    same.erase(in.dst);
+                }
+                forEachUse(in, [&](const string& x) { if (isNameOperand(x)) liveByBase[ssaBase(x)].insert(x); });
+            }
+        }
+
+        unordered_map<string, string> rename;
+        unordered_map<string, vector<string>> holders;   // base -> versions already mapped to it
+        auto assign = [&](const string& v) {
+            if (rename.count(v)) return;
+            string base = ssaBase(v);
+            auto& hs = holders[base];
+            bool free = true;
+            auto c = clash.find(v);
+            if (c != clash.end())
+                for (const auto& h : hs)
+                    if (c->second.count(h)) { free = false; break; }
+            if (free) { hs.push_back(v); rename[v] = base; }
+            else rename[v] = v;
+        };
+        // Entry values ("x.0", e.g. parameters) claim their base name first.
+        for (const auto& in : code)
+            forEachUse(in, [&](const string& x) { if (isNameOperand(x) && x.size() > 2 && x.compare(x.size() - 2, 2, ".0") == 0) assign(x); });
+        for (const auto& in : code) {
+            forEachUse(in, [&](const string& x) { if (isNameOperand(x)) assign(x); });
+            if (tacDefines(in)) assign(in.dst);
+        }
+
+        for (auto& in : code) {
+            forEachUse(in, [&](string& x) { if (isNameOperand(x)) x = rename[x]; });
+            if (tacDefines(in)) in.dst = rename[in.dst];
+        }
+        code.erase(remove_if(code.begin(), code.end(),
+                             [](const TACInstr& in) { return in.kind == TACKind::Copy && in.dst == in.a; }),
+                   code.end());
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        nextTemp = maxNumbered(code, TEMP_PREFIX);
+        CFG cfg(std::move(code));
+        splitCriticalEdges(cfg);
+        eliminatePhis(cfg);
+        code = cfg.flatten();
+        renameVersions(code);
+        dropJumpsToNext(code);
+        dropUnusedLabels(code);
+    }
+};
+
+// Reassociation of + and * (associative and commutative under wrap-around
+// arithmetic). A chain of single-use operations with the same operator, like the
+// left-deep tree the parser builds for a+b+c+d, is flattened into its operand
+// list; constants are folded into one operand and the rest is rebuilt as a
+// balanced tree, (a+b)+(c+d), so the dependency chain is log N deep instead of N.
+class Reassociator {
+    unordered_map<string, size_t> defIndex;
+    unordered_map<string, size_t> onlyUser;   // names with exactly one use -> that use
+    unordered_set<string> multiUse;
+    vector<size_t> blockId;                   // chains never cross a block boundary
+    int nextTemp = 0;
+
+    static bool reassociable(const TACInstr& in) {
+        return in.kind == TACKind::Binary && (in.op == "+" || in.op == "*");
+    }
+
+    // Folded into its user: same operator and nobody else reads the value.
+    bool interior(const vector<TACInstr>& code, size_t k) const {
+        const string& d = code[k].dst;
+        if (multiUse.count(d)) return false;
+        auto u = onlyUser.find(d);
+        return u != onlyUser.end() && reassociable(code[u->second]) && code[u->second].op == code[k].op &&
+               blockId[u->second] == blockId[k];
+    }
+
+    string freshTemp() { return TEMP_PREFIX + to_string(++nextTemp) + ".1"; }
+
+public:
+    void run(vector<TACInstr>& code) {
+        defIndex.clear(); onlyUser.clear(); multiUse.clear();
+        blockId.assign(code.size(), 0);
+        nextTemp = maxNumbered(code, TEMP_PREFIX);
+        for (size_t k = 0; k < code.size(); k++) {
+            if (k > 0) blockId[k] = blockId[k - 1] + (code[k].kind == TACKind::Label || tacIsJump(code[k - 1]));
+            if (tacDefines(code[k])) defIndex[code[k].dst] = k;
+            forEachUse(code[k], [&](const string& x) {
+                if (!isNameOperand(x) || multiUse.count(x)) return;
+                if (!onlyUser.emplace(x, k).second) { onlyUser.erase(x); multiUse.insert(x); }
+            });
+        }
+
+        vector<bool> absorbed(code.size(), false);
+        vector<vector<TACInstr>> prefix(code.size());
+
+        for (size_t k = 0; k < code.size(); k++) {
+            if (!reassociable(code[k]) || interior(code, k)) continue;
+            const string op = code[k].op;
+
+            // Flatten the chain left to right (explicit stack: chains can be very long).
+            vector<string> leaves, stack{code[k].b, code[k].a};
+            size_t merged = 0;
+            while (!stack.empty()) {
+                string x = stack.back();
+                stack.pop_back();
+                auto d = defIndex.find(x);
+                if (d != defIndex.end() && reassociable(code[d->second]) && interior(code, d->second)) {
+                    absorbed[d->second] = true;
+                    merged++;
+                    stack.push_back(code[d->second].b);
+                    stack.push_back(code[d->second].a);
+                } else {
+                    leaves.push_back(x);
+                }
+            }
+
+            int32_t folded = (op == "+") ? 0 : 1;
+            size_t constants = 0;
+            vector<string> terms;
+            for (const auto& x : leaves) {
+                int32_t v;
+                if (parseIntLiteral(x, v)) { foldBinary(op, folded, v, folded); constants++; }
+                else terms.push_back(x);
+            }
+            if (merged == 0 && constants < 2) continue;
+
+            bool identity = (op == "+" && folded == 0) || (op == "*" && folded == 1);
+            if (op == "*" && folded == 0) terms.clear();
+            if (terms.empty() || !identity) terms.push_back(to_string(folded));
+
+            // Pairwise combine until two operands remain for the original instruction.
+            while (terms.size() > 2) {
+                vector<string> next;
+                for (size_t i = 0; i + 1 < terms.size(); i += 2) {
+                    string t = freshTemp();
+                    prefix[k].push_back({TACKind::Binary, t, terms[i], terms[i + 1], op});
+                    next.push_back(t);
+                }
+                if (terms.size() % 2) next.push_back(terms.back());
+                terms.swap(next);
+            }
+            if (terms.size() == 1) code[k] = {TACKind::Copy, code[k].dst, terms[0], "", ""};
+            else code[k] = {TACKind::Binary, code[k].dst, terms[0], terms[1], op};
+        }
+
+        vector<TACInstr> out;
+        out.reserve(code.size());
+        for (size_t k = 0; k < code.size(); k++) {
+            if (absorbed[k]) continue;
+            for (auto& in : prefix[k]) out.push_back(std::move(in));
+            out.push_back(std::move(code[k]));
+        }
+        code.swap(out);
+    }
+};
+
+// Sparse conditional constant propagation (Wegman-Zadeck): a lattice value per
+// SSA name (unknown -> constant -> overdefined) and an executable flag per CFG
+// edge, driven by two worklists. A branch on a constant only makes one edge
+// executable, so code behind it is never evaluated and phis ignore its values.
+// Afterwards constants are substituted, decided branches become plain jumps
+// (or fall through) and never-executed blocks are deleted.
+class SCCP {
+    enum class Lat { Top, Const, Bottom };
+    struct Cell { Lat lat = Lat::Top; int32_t val = 0; };
+
+    unordered_map<string, Cell> cells;
+
+    Cell operandCell(const string& x) const {
+        int32_t v;
+        if (parseIntLiteral(x, v)) return {Lat::Const, v};
+        auto it = cells.find(x);
+        return it == cells.end() ? Cell{Lat::Bottom, 0} : it->second;
+    }
+
+    static Cell meet(Cell a, Cell b) {
+        if (a.lat == Lat::Top) return b;
+        if (b.lat == Lat::Top) return a;
+        if (a.lat == Lat::Const && b.lat == Lat::Const && a.val == b.val) return a;
+        return {Lat::Bottom, 0};
+    }
+
+    Cell evaluate(const TACInstr& in) const {
+        if (in.kind == TACKind::Load || in.kind == TACKind::Call) return {Lat::Bottom, 0};   // not tracked
+        Cell a = operandCell(in.a);
+        if (in.kind == TACKind::Copy) return a;
+        Cell b = operandCell(in.b);
+        if (a.lat == Lat::Bottom || b.lat == Lat::Bottom) return {Lat::Bottom, 0};
+        if (a.lat == Lat::Top || b.lat == Lat::Top) return {Lat::Top, 0};
+        int32_t v;
+        if (foldBinary(in.op, a.val, b.val, v)) return {Lat::Const, v};
+        return {Lat::Bottom, 0};
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        cells.clear();
+        CFG cfg(std::move(code));
+        size_t n = cfg.blocks.size();
+
+        unordered_map<string, vector<pair<size_t, size_t>>> users;   // name -> (block, index)
+        for (size_t b = 0; b < n; b++) {
+            const auto& bc = cfg.blocks[b].code;
+            for (size_t k = 0; k < bc.size(); k++) {
+                if (tacDefines(bc[k])) cells[bc[k].dst] = Cell{};
+                forEachUse(bc[k], [&](const string& x) { if (isNameOperand(x)) users[x].push_back({b, k}); });
+            }
+        }
+
+        vector<bool> execBlock(n, false);
+        unordered_set<uint64_t> execEdge;
+        auto edgeKey = [&](size_t from, size_t to) { return (uint64_t)from * n + to; };
+        vector<pair<size_t, size_t>> flowWork{{SIZE_MAX, 0}}, ssaWork;
+
+        auto markEdge = [&](size_t from, size_t to) { flowWork.push_back({from, to}); };
+
+        auto visit = [&](size_t b, size_t k) {
+            const BasicBlock& bb = cfg.blocks[b];
+            const TACInstr& in = bb.code[k];
+            if (in.kind == TACKind::IfFalse) {
+                Cell c = operandCell(in.a);
+                size_t target = cfg.blockOf(in.label);
+                if (c.lat == Lat::Top) return;
+                bool taken = c.lat == Lat::Bottom || c.val == 0;
+                bool notTaken = c.lat == Lat::Bottom || c.val != 0;
+                if (taken) markEdge(b, target);
+                if (notTaken && b + 1 < n) markEdge(b, b + 1);
+                return;
+            }
+            if (in.kind == TACKind::Goto) { markEdge(b, cfg.blockOf(in.label)); return; }
+            if (!tacDefines(in)) return;
+
+            Cell now;
+            if (in.kind == TACKind::Phi) {
+                for (const auto& arg : in.phi) {
+                    size_t from = cfg.blockOf(arg.second);
+                    if (execEdge.count(edgeKey(from, b))) now = meet(now, operandCell(arg.first));
+                }
+            } else {
+                now = evaluate(in);
+            }
+            Cell& old = cells[in.dst];
+            if (now.lat == old.lat && now.val == old.val) return;
+            old = now;
+            for (const auto& u : users[in.dst])
+                if (execBlock[u.first]) ssaWork.push_back(u);
+        };
+
+        while (!flowWork.empty() || !ssaWork.empty()) {
+            if (!flowWork.empty()) {
+                auto [from, to] = flowWork.back();
+                flowWork.pop_back();
+                if (from != SIZE_MAX && !execEdge.insert(edgeKey(from, to)).second) continue;
+                const auto& bc = cfg.blocks[to].code;
+                if (execBlock[to]) {
+                    for (size_t k = 0; k < bc.size() && bc[k].kind == TACKind::Phi; k++) visit(to, k);
+                    continue;
+                }
+                execBlock[to] = true;
+                for (size_t k = 0; k < bc.size(); k++) visit(to, k);
+                bool fallsThrough = bc.empty() || !tacIsJump(bc.back());
+                if (fallsThrough && to + 1 < n) markEdge(to, to + 1);
+                continue;
+            }
+            auto [b, k] = ssaWork.back();
+            ssaWork.pop_back();
+            visit(b, k);
+        }
+
+        auto isConst = [&](const string& name, int32_t& v) {
+            auto it = cells.find(name);
+            if (it == cells.end() || it->second.lat != Lat::Const) return false;
+            v = it->second.val;
+            return true;
+        };
+
+        vector<BasicBlock> kept;
+        for (size_t b = 0; b < n; b++) {
+            if (!execBlock[b]) continue;
+            BasicBlock& bb = cfg.blocks[b];
+            vector<TACInstr> out;
+            for (auto& in : bb.code) {
+                if (in.kind == TACKind::Phi) {
+                    in.phi.erase(remove_if(in.phi.begin(), in.phi.end(),
+                                           [&](const pair<string, string>& arg) {
+                                               return !execEdge.count(edgeKey(cfg.blockOf(arg.second), b));
+                                           }),
+                                 in.phi.end());
+                }
+                forEachUse(in, [&](string& x) {
+                    Cell c = operandCell(x);
+                    if (c.lat == Lat::Const) x = to_string(c.val);
+                });
+                int32_t v;
+                if (tacDefines(in) && isConst(in.dst, v)) {
+                    out.push_back({TACKind::Copy, in.dst, to_string(v), "", ""});
+                    continue;
+                }
+                if (in.kind == TACKind::IfFalse && parseIntLiteral(in.a, v)) {
+                    if (v == 0) out.push_back({TACKind::Goto, "", "", "", "", in.label});
+                    continue;
+                }
+                out.push_back(std::move(in));
+            }
+            bb.code.swap(out);
+            kept.push_back(std::move(bb));
+        }
+        cfg.blocks.swap(kept);
+        cfg.rebuildEdges();
+
+        // A phi left with a single incoming value is just a copy. Phis that
+        // became copies move behind the remaining phis, which must stay first.
+        for (auto& bb : cfg.blocks) {
+            for (auto& in : bb.code)
+                if (in.kind == TACKind::Phi && in.phi.size() == 1)
+                    in = {TACKind::Copy, in.dst, in.phi[0].first, "", ""};
+            stable_partition(bb.code.begin(), bb.code.end(), [](const TACInstr& in) { return in.kind == TACKind::Phi; });
+        }
+
+        code = cfg.flatten();
+    }
+};
+
+// Global value numbering over the dominator tree: an expression already
+// computed in a dominating block is reused (operands of + * == != ordered
+// canonically), copies forward their source, and a phi whose incoming values
+// are all the same collapses to that value. Leaders always dominate the names
+// they replace, so every use can be rewritten in a final sweep.
+class GVN {
+    unordered_map<string, string> leader;   // SSA name -> name holding the same value
+
+    string find(const string& x) {
+        auto it = leader.find(x);
+        if (it == leader.end()) return x;
+        string root = find(it->second);
+        it->second = root;
+        return root;
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        leader.clear();
+        CFG cfg(std::move(code));
+        vector<vector<size_t>> kids = CFG::domChildren(cfg.immediateDominators());
+
+        unordered_map<string, string> table;    // expression key -> leader (scoped to the dominator subtree)
+        struct Frame { size_t block, nextKid; vector<string> added; };
+        vector<Frame> stack;
+        stack.push_back({0, 0, {}});
+        bool entering = true;
+        while (!stack.empty()) {
+            if (entering) {
+                Frame& f = stack.back();
+                for (auto& in : cfg.blocks[f.block].code) {
+                    if (in.kind == TACKind::Phi) {
+                        string same;
+                        bool unique = true;
+                        for (const auto& arg : in.phi) {
+                            string v = find(arg.first);
+                            if (v == in.dst) continue;
+                            if (same.empty()) same = v;
+                            else if (same != v) { unique = false; break; }
+                        }
+                        if (unique && !same.empty()) leader[in.dst] = same;
+                        continue;
+                    }
+                    forEachUse(in, [&](string& x) { x = find(x); });
+                    if (in.kind == TACKind::Copy) {
+                        leader[in.dst] = in.a;
+                        continue;
+                    }
+                    if (in.kind != TACKind::Binary) continue;
+
+                    string l = in.a, r = in.b;
+                    bool commutative = in.op == "+" || in.op == "*" || in.op == "==" || in.op == "!=";
+                    if (commutative && r < l) swap(l, r);
+                    string key = l + " " + in.op + " " + r;
+                    auto it = table.find(key);
+                    if (it != table.end()) {
+                        leader[in.dst] = it->second;
+                        in = {TACKind::Copy, in.dst, it->second, "", ""};
+                    } else {
+                        table.emplace(key, in.dst);
+                        f.added.push_back(key);
+                    }
+                }
+            }
+            Frame& f = stack.back();
+            if (f.nextKid < kids[f.block].size()) {
+                size_t k = kids[f.block][f.nextKid++];
+                stack.push_back({k, 0, {}});
+                entering = true;
+            } else {
+                for (const auto& key : f.added) table.erase(key);
+                stack.pop_back();
+                entering = false;
+            }
+        }
+
+        for (auto& bb : cfg.blocks)
+            for (auto& in : bb.code)
+                forEachUse(in, [&](string& x) { if (isNameOperand(x)) x = find(x); });
+        code = cfg.flatten();
+    }
+};
+
+// Natural loops: for every back edge (latch -> header, header dominating the
+// latch) the blocks that reach the latch without passing through the header.
+// Loops are listed inner first (smaller bodies before the loops containing them).
+struct LoopInfo {
+    struct Loop {
+        size_t header;
+        vector<size_t> latches;
+        vector<size_t> body;       // includes the header
+        size_t preheader = SIZE_MAX;
+    };
+
+    vector<Loop> loops;
+    vector<size_t> idom, pre, post;
+
+    bool dominates(size_t a, size_t b) const { return pre[a] <= pre[b] && post[b] <= post[a]; }
+
+    explicit LoopInfo(const CFG& cfg) {
+        size_t n = cfg.blocks.size();
+        idom = cfg.immediateDominators();
+        vector<vector<size_t>> kids = CFG::domChildren(idom);
+
+        // Dominator-tree entry/exit numbers make dominance an O(1) query.
+        pre.assign(n, SIZE_MAX);
+        post.assign(n, 0);
+        size_t clock = 0;
+        vector<pair<size_t, size_t>> stack{{0, 0}};
+        pre[0] = clock++;
+        while (!stack.empty()) {
+            auto& [b, k] = stack.back();
+            if (k < kids[b].size()) {
+                size_t c = kids[b][k++];
+                pre[c] = clock++;
+                stack.push_back({c, 0});
+            } else {
+                post[b] = clock++;
+                stack.pop_back();
+            }
+        }
+
+        unordered_map<size_t, size_t> byHeader;
+        for (size_t b = 0; b < n; b++) {
+            if (pre[b] == SIZE_MAX) continue;
+            for (size_t h : cfg.blocks[b].succ) {
+                if (!dominates(h, b)) continue;
+                auto it = byHeader.find(h);
+                if (it == byHeader.end()) {
+                    it = byHeader.emplace(h, loops.size()).first;
+                    loops.push_back({h, {}, {h}});
+                }
+                loops[it->second].latches.push_back(b);
+            }
+        }
+
+        vector<size_t> stamp(n, SIZE_MAX);
+        for (size_t li = 0; li < loops.size(); li++) {
+            Loop& L = loops[li];
+            stamp[L.header] = li;
+            vector<size_t> work;
+            for (size_t l : L.latches)
+                if (stamp[l] != li) { stamp[l] = li; L.body.push_back(l); work.push_back(l); }
+            while (!work.empty()) {
+                size_t b = work.back();
+                work.pop_back();
+                for (size_t p : cfg.blocks[b].pred)
+                    if (stamp[p] != li) { stamp[p] = li; L.body.push_back(p); work.push_back(p); }
+            }
+            sort(L.body.begin(), L.body.end());
+
+            vector<size_t> outside;
+            for (size_t p : cfg.blocks[L.header].pred)
+                if (!binary_search(L.body.begin(), L.body.end(), p)) outside.push_back(p);
+            if (outside.size() == 1 && cfg.blocks[outside[0]].succ.size() == 1) L.preheader = outside[0];
+        }
+        stable_sort(loops.begin(), loops.end(),
+                    [](const Loop& a, const Loop& b) { return a.body.size() < b.body.size(); });
+    }
+};
+
+// Gives every loop whose header is entered from a single outside block a
+// preheader: a block that only leads to the header. If the outside block
+// branches elsewhere too, an empty block is inserted on the fall-through edge.
+static void insertPreheaders(CFG& cfg) {
+    LoopInfo li(cfg);
+    vector<string> before(cfg.blocks.size());   // header index -> label of new preheader
+    bool any = false;
+    for (const auto& L : li.loops) {
+        if (L.preheader != SIZE_MAX || L.header == 0) continue;
+        vector<size_t> outside;
+        for (size_t p : cfg.blocks[L.header].pred)
+            if (!binary_search(L.body.begin(), L.body.end(), p)) outside.push_back(p);
+        if (outside.size() != 1 || outside[0] + 1 != L.header) continue;
+        const auto& pc = cfg.blocks[outside[0]].code;
+        if (!pc.empty() && tacIsJump(pc.back()) && pc.back().label == cfg.blocks[L.header].label) continue;
+
+        string label = cfg.freshLabel();
+        for (auto& in : cfg.blocks[L.header].code) {
+            if (in.kind != TACKind::Phi) break;
+            for (auto& arg : in.phi)
+                if (arg.second == cfg.blocks[outside[0]].label) arg.second = label;
+        }
+        before[L.header] = label;
+        any = true;
+    }
+    if (!any) return;
+
+    vector<BasicBlock> layout;
+    for (size_t b = 0; b < cfg.blocks.size(); b++) {
+        if (!before[b].empty()) {
+            BasicBlock ph;
+            ph.label = before[b];
+            layout.push_back(std::move(ph));
+        }
+        layout.push_back(std::move(cfg.blocks[b]));
+    }
+    cfg.blocks.swap(layout);
+    cfg.rebuildEdges();
+}
+
+// Appends instructions to a block, ahead of its closing jump if it has one.
+static void appendBeforeJump(BasicBlock& bb, vector<TACInstr> code) {
+    auto& bc = bb.code;
+    auto at = (!bc.empty() && tacIsJump(bc.back())) ? bc.end() - 1 : bc.end();
+    bc.insert(at, make_move_iterator(code.begin()), make_move_iterator(code.end()));
+}
+
+// Loop-invariant code motion on SSA: an instruction in a loop whose operands
+// are all constants or defined outside the loop computes the same value on
+// every iteration and moves to the preheader. Hoisting executes it even when
+// the loop body would not run, so only operations that cannot trap qualify
+// (a division needs a constant divisor other than 0 and -1).
+class LICM {
+    static bool safeToSpeculate(const TACInstr& in) {
+        if (in.kind == TACKind::Copy) return true;
+        if (in.kind != TACKind::Binary) return false;
+        if (in.op != "/") return true;
+        int32_t d;
+        return parseIntLiteral(in.b, d) && d != 0 && d != -1;
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        CFG cfg(std::move(code));
+        insertPreheaders(cfg);
+        LoopInfo li(cfg);
+
+        unordered_map<string, size_t> defBlock;
+        for (size_t b = 0; b < cfg.blocks.size(); b++)
+            for (const auto& in : cfg.blocks[b].code)
+                if (tacDefines(in)) defBlock[in.dst] = b;
+
+        for (const auto& L : li.loops) {
+            if (L.preheader == SIZE_MAX) continue;
+            auto inLoop = [&](size_t b) { return binary_search(L.body.begin(), L.body.end(), b); };
+            auto invariant = [&](const string& x) {
+                if (!isNameOperand(x)) return true;
+                auto it = defBlock.find(x);
+                return it == defBlock.end() || !inLoop(it->second);
+            };
+
+            vector<TACInstr> hoisted;
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (size_t b : L.body) {
+                    auto& bc = cfg.blocks[b].code;
+                    vector<TACInstr> stay;
+                    for (auto& in : bc) {
+                        bool inv = safeToSpeculate(in);
+                        if (inv) forEachUse(in, [&](const string& x) { inv = inv && invariant(x); });
+                        if (inv) {
+                            defBlock[in.dst] = L.preheader;
+                            hoisted.push_back(std::move(in));
+                            changed = true;
+                        } else {
+                            stay.push_back(std::move(in));
+                        }
+                    }
+                    bc.swap(stay);
+                }
+            }
+            appendBeforeJump(cfg.blocks[L.preheader], std::move(hoisted));
+        }
+        code = cfg.flatten();
+    }
+};
+
+// Induction-variable strength reduction on SSA. A basic induction variable is
+// a header phi i = phi [init, preheader], [i + c, latch] with constant c.
+// A product j = i * k with k loop-invariant is the same as a second variable
+// s = phi [init * k, preheader], [s + c * k, latch] (also under wrap-around),
+// so the multiplication in the loop becomes one addition per iteration.
+class IVStrengthReduction {
+    int nextTemp = 0;
+
+    string freshTemp() { return TEMP_PREFIX + to_string(++nextTemp) + ".1"; }
+
+public:
+    void run(vector<TACInstr>& code) {
+        nextTemp = maxNumbered(code, TEMP_PREFIX);
+        CFG cfg(std::move(code));
+        insertPreheaders(cfg);
+        LoopInfo li(cfg);
+
+        unordered_map<string, size_t> defBlock;
+        unordered_map<string, const TACInstr*> defInstr;
+        for (size_t b = 0; b < cfg.blocks.size(); b++)
+            for (const auto& in : cfg.blocks[b].code)
+                if (tacDefines(in)) { defBlock[in.dst] = b; defInstr[in.dst] = &in; }
+
+        for (const auto& L : li.loops) {
+            if (L.preheader == SIZE_MAX || L.latches.size() != 1) continue;
+            auto inLoop = [&](size_t b) { return binary_search(L.body.begin(), L.body.end(), b); };
+            auto invariant = [&](const string& x) {
+                if (!isNameOperand(x)) return true;
+                auto it = defBlock.find(x);
+                return it == defBlock.end() || !inLoop(it->second);
+            };
+            BasicBlock& header = cfg.blocks[L.header];
+            const string& preLabel = cfg.blocks[L.preheader].label;
+            const string& latchLabel = cfg.blocks[L.latches[0]].label;
+
+            struct IV { string init, next; int32_t step; };
+            unordered_map<string, IV> ivs;
+            for (const auto& in : header.code) {
+                if (in.kind != TACKind::Phi) break;
+                if (in.phi.size() != 2) continue;
+                string init, next;
+                for (const auto& arg : in.phi) {
+                    if (arg.second == preLabel) init = arg.first;
+                    else if (arg.second == latchLabel) next = arg.first;
+                }
+                auto d = defInstr.find(next);
+                while (d != defInstr.end() && d->second->kind == TACKind::Copy && isNameOperand(d->second->a)) {
+                    next = d->second->a;   // look through "i = t" copies to the actual increment
+                    d = defInstr.find(next);
+                }
+                if (init.empty() || d == defInstr.end() || !inLoop(defBlock[next])) continue;
+                const TACInstr& inc = *d->second;
+                int32_t c;
+                if (inc.kind != TACKind::Binary) continue;
+                if (inc.op == "+" && inc.a == in.dst && parseIntLiteral(inc.b, c)) ivs[in.dst] = {init, next, c};
+                else if (inc.op == "+" && inc.b == in.dst && parseIntLiteral(inc.a, c)) ivs[in.dst] = {init, next, c};
+                else if (inc.op == "-" && inc.a == in.dst && parseIntLiteral(inc.b, c)) ivs[in.dst] = {init, next, (int32_t)(0u - (uint32_t)c)};
+            }
+            if (ivs.empty()) continue;
+
+            vector<TACInstr> prelude, newPhis;
+            unordered_map<string, vector<TACInstr>> afterDef;    // IV increment -> new increments
+            map<pair<string, string>, string> reduced;            // (iv, k) -> replacement phi
+            for (size_t b : L.body) {
+                for (auto& in : cfg.blocks[b].code) {
+                    if (in.kind != TACKind::Binary || in.op != "*") continue;
+                    string iv, k;
+                    if (ivs.count(in.a) && invariant(in.b)) { iv = in.a; k = in.b; }
+                    else if (ivs.count(in.b) && invariant(in.a)) { iv = in.b; k = in.a; }
+                    else continue;
+
+                    auto key = make_pair(iv, k);
+                    auto done = reduced.find(key);
+                    if (done == reduced.end()) {
+                        const IV& v = ivs[iv];
+                        // Both versions share one base so SSA destruction can coalesce
+                        // the update into a single "tN = tN + step".
+                        string s = freshTemp(), sNext = s.substr(0, s.size() - 1) + "2";
+                        int32_t ik, iinit, prod;
+                        string start, step;
+                        if (parseIntLiteral(k, ik) && parseIntLiteral(v.init, iinit) && foldBinary("*", iinit, ik, prod)) {
+                            start = to_string(prod);
+                        } else {
+                            start = freshTemp();
+                            prelude.push_back({TACKind::Binary, start, v.init, k, "*"});
+                        }
+                        if (parseIntLiteral(k, ik) && foldBinary("*", v.step, ik, prod)) {
+                            step = to_string(prod);
+                        } else {
+                            step = freshTemp();
+                            prelude.push_back({TACKind::Binary, step, k, to_string(v.step), "*"});
+                        }
+                        TACInstr phi{TACKind::Phi, s, "", "", ""};
+                        phi.phi = {{start, preLabel}, {sNext, latchLabel}};
+                        newPhis.push_back(std::move(phi));
+                        afterDef[v.next].push_back({TACKind::Binary, sNext, s, step, "+"});
+                        done = reduced.emplace(key, s).first;
+                    }
+                    in = {TACKind::Copy, in.dst, done->second, "", ""};
+                }
+            }
+            if (reduced.empty()) continue;
+
+            for (const auto& in : prelude) defBlock[in.dst] = L.preheader;
+            appendBeforeJump(cfg.blocks[L.preheader], std::move(prelude));
+            header.code.insert(header.code.begin(), newPhis.begin(), newPhis.end());
+            for (const auto& ph : newPhis) defBlock[ph.dst] = L.header;
+            for (size_t b : L.body) {
+                auto& bc = cfg.blocks[b].code;
+                vector<TACInstr> out;
+                for (auto& in : bc) {
+                    bool isInc = tacDefines(in) && afterDef.count(in.dst);
+                    string d = in.dst;
+                    out.push_back(std::move(in));
+                    if (isInc)
+                        for (auto& add : afterDef[d]) { defBlock[add.dst] = b; out.push_back(std::move(add)); }
+                }
+                bc.swap(out);
+            }
+            // Block contents moved; refresh the definition pointers for the next loop.
+            defInstr.clear();
+            for (size_t b = 0; b < cfg.blocks.size(); b++)
+                for (const auto& in : cfg.blocks[b].code)
+                    if (tacDefines(in)) defInstr[in.dst] = &in;
+        }
+        code = cfg.flatten();
+    }
+};
+
+// Bounds-check elimination by range analysis on SSA. Every SSA name gets an
+// interval; a branch on "x < y" (or any other comparison) narrows x and y in
+// the blocks that only the edge where the comparison is known leads to, as a
+// separate "sigma" view of the name (e-SSA style, kept inside the pass).
+// Intervals grow from empty to a fixed point; phis that keep growing are
+// widened to the type bounds, then a few plain rounds narrow them back. A
+// check whose index interval lies within [0, N) can never fail and is deleted,
+// and so is a check repeated on the same index under a dominating one.
+class BoundsCheckEliminator {
+    struct Range {
+        int64_t lo = 1, hi = 0;   // empty (not reached yet) while lo > hi
+        bool empty() const { return lo > hi; }
+        bool operator==(const Range& o) const { return (empty() && o.empty()) || (lo == o.lo && hi == o.hi); }
+    };
+    static Range full() { return {INT32_MIN, INT32_MAX}; }
+
+    // One node per SSA definition, literal and sigma view.
+    enum class NodeKind { Const, Full, Copy, Binary, Phi, Sigma };
+    struct Node {
+        NodeKind kind;
+        string op;            // Binary: the operator; Sigma: relation "view op bound" known to hold
+        vector<size_t> in;    // Sigma: {view, bound}
+        Range val;
+    };
+
+    vector<Node> nodes;
+    vector<vector<size_t>> users;
+
+    size_t addNode(NodeKind kind, string op = "", vector<size_t> in = {}) {
+        nodes.push_back({kind, std::move(op), std::move(in), {}});
+        users.emplace_back();
+        return nodes.size() - 1;
+    }
+
+    static Range binary(const string& op, Range a, Range b) {
+        if (a.empty() || b.empty()) return {};
+        Range r;
+        if (op == "+") r = {a.lo + b.lo, a.hi + b.hi};
+        else if (op == "-") r = {a.lo - b.hi, a.hi - b.lo};
+        else if (op == "*") {
+            int64_t c[] = {a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi};
+            r = {*min_element(c, c + 4), *max_element(c, c + 4)};
+        } else if (op == "/") {
+            if (b.lo <= 0 && b.hi >= 0) return full();   // may divide by 0 (or by -1)
+            int64_t c[] = {a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi};
+            r = {*min_element(c, c + 4), *max_element(c, c + 4)};
+        } else {
+            return {0, 1};   // comparisons
+        }
+        return (r.lo < INT32_MIN || r.hi > INT32_MAX) ? full() : r;   // may wrap around
+    }
+
+    static Range sigma(const string& rel, Range x, Range y) {
+        if (x.empty() || y.empty()) return {};
+        if (rel == "<")       x.hi = min(x.hi, y.hi - 1);
+        else if (rel == "<=") x.hi = min(x.hi, y.hi);
+        else if (rel == ">")  x.lo = max(x.lo, y.lo + 1);
+        else if (rel == ">=") x.lo = max(x.lo, y.lo);
+        else if (rel == "==") { x.lo = max(x.lo, y.lo); x.hi = min(x.hi, y.hi); }
+        else if (rel == "!=" && y.lo == y.hi) {
+            if (x.lo == y.lo) x.lo++;
+            if (x.hi == y.lo) x.hi--;
+        }
+        return x;
+    }
+
+    Range evaluate(const Node& nd) const {
+        switch (nd.kind) {
+            case NodeKind::Const:
+            case NodeKind::Full:   return nd.val;
+            case NodeKind::Copy:   return nodes[nd.in[0]].val;
+            case NodeKind::Binary: return binary(nd.op, nodes[nd.in[0]].val, nodes[nd.in[1]].val);
+            case NodeKind::Sigma:  return sigma(nd.op, nodes[nd.in[0]].val, nodes[nd.in[1]].val);
+            case NodeKind::Phi: {
+                Range r;
+                for (size_t k : nd.in) {
+                    const Range& v = nodes[k].val;
+                    if (v.empty()) continue;
+                    if (r.empty()) r = v;
+                    else { r.lo = min(r.lo, v.lo); r.hi = max(r.hi, v.hi); }
+                }
+                return r;
+            }
+        }
+        return full();
+    }
+
+    void solve() {
+        for (size_t k = 0; k < nodes.size(); k++)
+            for (size_t i : nodes[k].in) users[i].push_back(k);
+
+        vector<int> growth(nodes.size(), 0);
+        vector<size_t> work;
+        for (size_t k = nodes.size(); k-- > 0;) work.push_back(k);
+        vector<bool> queued(nodes.size(), true);
+        while (!work.empty()) {
+            size_t k = work.back();
+            work.pop_back();
+            queued[k] = false;
+            Node& nd = nodes[k];
+            Range now = evaluate(nd);
+            if (now == nd.val) continue;
+            if (nd.kind == NodeKind::Phi && !nd.val.empty() && ++growth[k] > 2) {
+                if (now.lo < nd.val.lo) now.lo = INT32_MIN;
+                if (now.hi > nd.val.hi) now.hi = INT32_MAX;
+            }
+            nd.val = now;
+            for (size_t u : users[k])
+                if (!queued[u]) { queued[u] = true; work.push_back(u); }
+        }
+        // Narrowing: from a post-fixed point, plain re-evaluation stays sound.
+        for (int round = 0; round < 2; round++)
+            for (auto& nd : nodes)
+                if (nd.kind != NodeKind::Const && nd.kind != NodeKind::Full) nd.val = evaluate(nd);
+    }
+
+    static string swapRelation(const string& rel) {
+        if (rel == "<") return ">";
+        if (rel == "<=") return ">=";
+        if (rel == ">") return "<";
+        if (rel == ">=") return "<=";
+        return rel;
+    }
+
+    static string negateRelation(const string& rel) {
+        if (rel == "<") return ">=";
+        if (rel == "<=") return ">";
+        if (rel == ">") return "<=";
+        if (rel == ">=") return "<";
+        if (rel == "==") return "!=";
+        return "==";
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        nodes.clear();
+        users.clear();
+        CFG cfg(std::move(code));
+        size_t n = cfg.blocks.size();
+        vector<vector<size_t>> kids = CFG::domChildren(cfg.immediateDominators());
+
+        unordered_map<string, const TACInstr*> defOf;
+        for (const auto& bb : cfg.blocks)
+            for (const auto& in : bb.code)
+                if (tacDefines(in)) defOf[in.dst] = &in;
+
+        // The comparison a block's single predecessor branched on, as known on the way in.
+        auto entryFact = [&](size_t b, string& x, string& rel, string& y) {
+            const auto& pred = cfg.blocks[b].pred;
+            if (pred.size() != 1) return false;
+            size_t d = pred[0];
+            const auto& dc = cfg.blocks[d].code;
+            if (dc.empty() || dc.back().kind != TACKind::IfFalse) return false;
+            size_t target = cfg.blockOf(dc.back().label);
+            if (target == d + 1) return false;
+            auto def = defOf.find(dc.back().a);
+            if (def == defOf.end() || def->second->kind != TACKind::Binary) return false;
+            const TACInstr& cmp = *def->second;
+            if (cmp.op != "<" && cmp.op != "<=" && cmp.op != ">" && cmp.op != ">=" && cmp.op != "==" && cmp.op != "!=")
+                return false;
+            x = cmp.a;
+            y = cmp.b;
+            rel = (b == target) ? negateRelation(cmp.op) : cmp.op;
+            return true;
+        };
+
+        // Walk the dominator tree; 'view' maps an SSA name to the node that
+        // describes it in the current block (its definition or a sigma).
+        unordered_map<string, vector<size_t>> view;
+        unordered_map<string, size_t> literal;
+        auto nodeOf = [&](const string& x) {
+            if (!isNameOperand(x)) {
+                auto it = literal.find(x);
+                if (it != literal.end()) return it->second;
+                int32_t v;
+                size_t k = addNode(NodeKind::Full);
+                nodes[k].val = full();
+                if (parseIntLiteral(x, v)) { nodes[k].kind = NodeKind::Const; nodes[k].val = {v, v}; }
+                literal[x] = k;
+                return k;
+            }
+            auto& vs = view[x];
+            if (vs.empty()) {   // value on entry (x.0)
+                size_t k = addNode(NodeKind::Full);
+                nodes[k].val = full();
+                vs.push_back(k);
+            }
+            return vs.back();
+        };
+
+        // Phi nodes exist up front: a predecessor can be walked before its successor.
+        struct PendingPhi { size_t node; const TACInstr* in; };
+        vector<vector<PendingPhi>> phisAt(n);
+        for (size_t b = 0; b < n; b++)
+            for (const auto& in : cfg.blocks[b].code)
+                if (in.kind == TACKind::Phi) phisAt[b].push_back({addNode(NodeKind::Phi), &in});
+        struct CheckSite { size_t block, index, node; int32_t size; };
+        vector<CheckSite> checks;
+        vector<pair<size_t, size_t>> redundant;          // (block, index) of repeated checks
+        unordered_set<string> checked;                   // "index size" pairs checked in dominating code
+
+        struct Frame { size_t block, nextKid; vector<string> pushed, checkedHere; };
+        vector<Frame> stack;
+        stack.push_back({0, 0, {}, {}});
+        bool entering = true;
+        while (!stack.empty()) {
+            if (entering) {
+                Frame& f = stack.back();
+                size_t b = f.block;
+                string x, rel, y;
+                if (entryFact(b, x, rel, y)) {
+                    size_t vx = nodeOf(x), vy = nodeOf(y);
+                    if (isNameOperand(x)) { view[x].push_back(addNode(NodeKind::Sigma, rel, {vx, vy})); f.pushed.push_back(x); }
+                    if (isNameOperand(y)) { view[y].push_back(addNode(NodeKind::Sigma, swapRelation(rel), {vy, vx})); f.pushed.push_back(y); }
+                }
+                const auto& bc = cfg.blocks[b].code;
+                size_t phiIdx = 0;
+                for (size_t k = 0; k < bc.size(); k++) {
+                    const TACInstr& in = bc[k];
+                    if (in.kind == TACKind::Check) {
+                        string key = in.a + " " + in.b;
+                        if (isNameOperand(in.a) && checked.count(key)) { redundant.push_back({b, k}); continue; }
+                        checks.push_back({b, k, nodeOf(in.a), (int32_t)atoi(in.b.c_str())});
+                        if (checked.insert(key).second) f.checkedHere.push_back(key);
+                        continue;
+                    }
+                    if (!tacDefines(in)) continue;
+                    size_t nd;
+                    switch (in.kind) {
+                        case TACKind::Copy:   nd = addNode(NodeKind::Copy, "", {nodeOf(in.a)}); break;
+                        case TACKind::Binary: nd = addNode(NodeKind::Binary, in.op, {nodeOf(in.a), nodeOf(in.b)}); break;
+                        case TACKind::Phi:    nd = phisAt[b][phiIdx++].node; break;
+                        default:              nd = addNode(NodeKind::Full); nodes[nd].val = full(); break;
+                    }
+                    view[in.dst].push_back(nd);
+                    f.pushed.push_back(in.dst);
+                }
+                // Phi operands are read at the end of the predecessor, with its views.
+                for (size_t sIdx : cfg.blocks[b].succ)
+                    for (const auto& pp : phisAt[sIdx])
+                        for (const auto& arg : pp.in->phi)
+                            if (arg.second == cfg.blocks[b].label) {
+                                size_t v = nodeOf(arg.first);   // may grow 'nodes'
+                                nodes[pp.node].in.push_back(v);
+                            }
+            }
+            Frame& f = stack.back();
+            if (f.nextKid < kids[f.block].size()) {
+                size_t k = kids[f.block][f.nextKid++];
+                stack.push_back({k, 0, {}, {}});
+                entering = true;
+            } else {
+                for (const auto& name : f.pushed) view[name].pop_back();
+                for (const auto& key : f.checkedHere) checked.erase(key);
+                stack.pop_back();
+                entering = false;
+            }
+        }
+        solve();
+
+        vector<vector<bool>> drop(n);
+        for (size_t b = 0; b < n; b++) drop[b].assign(cfg.blocks[b].code.size(), false);
+        for (const auto& r : redundant) drop[r.first][r.second] = true;
+        for (const auto& c : checks) {
+            const Range& v = nodes[c.node].val;
+            if (!v.empty() && v.lo >= 0 && v.hi < c.size) drop[c.block][c.index] = true;
+        }
+        for (size_t b = 0; b < n; b++) {
+            auto& bc = cfg.blocks[b].code;
+            size_t w = 0;
+            for (size_t k = 0; k < bc.size(); k++) {
+                if (drop[b][k]) continue;
+                if (w != k) bc[w] = std::move(bc[k]);
+                w++;
+            }
+            bc.resize(w);
+        }
+        code = cfg.flatten();
+    }
+};
+
+// Mark-and-sweep DCE on SSA: prints, stores, checks, calls, returns and branches are the roots, every
+// definition reachable through def-use edges from a root is kept, everything
+// else (including phis that only feed each other) is deleted.
+class SSADeadCodeEliminator {
+public:
+    void run(vector<TACInstr>& code) {
+        unordered_map<string, size_t> defIndex;
+        for (size_t k = 0; k < code.size(); k++)
+            if (tacDefines(code[k])) defIndex[code[k].dst] = k;
+
+        vector<bool> live(code.size(), false);
+        vector<size_t> work;
+        for (size_t k = 0; k < code.size(); k++)
+            if (!tacDefines(code[k]) || code[k].kind == TACKind::Call) { live[k] = true; work.push_back(k); }
+
+        while (!work.empty()) {
+            size_t k = work.back();
+            work.pop_back();
+            forEachUse(code[k], [&](const string& x) {
+                auto it = defIndex.find(x);
+                if (it != defIndex.end() && !live[it->second]) {
+                    live[it->second] = true;
+                    work.push_back(it->second);
+                }
+            });
+        }
+
+        size_t w = 0;
+        for (size_t k = 0; k < code.size(); k++) {
+            if (live[k]) {
+                if (w != k) code[w] = std::move(code[k]);
+                w++;
+            }
+        }
+        code.resize(w);
+    }
+};
+
+// =========================================================
+// 6b) FUNCTIONS: CALL GRAPH + INLINING
+// =========================================================
+// Who calls whom, read off the Call instructions (the top level is the
+// node ""). Tarjan's algorithm finds the strongly connected components: a
+// function is recursive when its component has more than one member or it
+// calls itself. Components come out callees first, which is the order the
+// pass manager optimizes functions in.
+struct CallGraph {
+    unordered_map<string, vector<string>> callees;   // sorted, without duplicates
+    unordered_map<string, size_t> callSites;         // Call instructions naming each function
+    unordered_map<string, size_t> indexOf;           // position in TACProgram::functions
+    unordered_set<string> recursive;
+    vector<string> bottomUp;                         // every function, callees before callers
+
+    explicit CallGraph(const TACProgram& prog) {
+        auto scan = [&](const string& caller, const vector<TACInstr>& code) {
+            auto& cs = callees[caller];
+            for (const auto& in : code) {
+                if (in.kind != TACKind::Call) continue;
+                cs.push_back(in.label);
+                callSites[in.label]++;
+            }
+            sort(cs.begin(), cs.end());
+            cs.erase(unique(cs.begin(), cs.end()), cs.end());
+        };
+        for (size_t k = 0; k < prog.functions.size(); k++) {
+            indexOf[prog.functions[k].name] = k;
+            callSites.emplace(prog.functions[k].name, 0);
+            scan(prog.functions[k].name, prog.functions[k].code);
+        }
+        scan("", prog.main);
+
+        // Iterative Tarjan (call chains can be as long as the program).
+        unordered_map<string, int> index, low;
+        unordered_set<string> onStack;
+        vector<string> stack;
+        int counter = 0;
+        auto visit = [&](const string& v) {
+            index[v] = low[v] = counter++;
+            stack.push_back(v);
+            onStack.insert(v);
+        };
+        for (const auto& f : prog.functions) {
+            if (index.count(f.name)) continue;
+            vector<pair<string, size_t>> work{{f.name, 0}};
+            visit(f.name);
+            while (!work.empty()) {
+                string v = work.back().first;
+                const auto& cs = callees[v];
+                if (work.back().second < cs.size()) {
+                    const string& w = cs[work.back().second++];
+                    if (!index.count(w)) { visit(w); work.push_back({w, 0}); }
+                    else if (onStack.count(w)) low[v] = min(low[v], index[w]);
+                    continue;
+                }
+                work.pop_back();
+                if (!work.empty()) low[work.back().first] = min(low[work.back().first], low[v]);
+                if (low[v] != index[v]) continue;
+                vector<string> scc;
+                string w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack.erase(w);
+                    scc.push_back(w);
+                } while (w != v);
+                bool selfCall = binary_search(cs.begin(), cs.end(), v);
+                for (const auto& x : scc) {
+                    if (scc.size() > 1 || selfCall) recursive.insert(x);
+                    bottomUp.push_back(x);
+                }
+            }
+        }
+    }
+
+    void print(ostream& os, const TACProgram& prog) const {
+        os << "CALL GRAPH:\n";
+        auto line = [&](const string& name, const string& shown) {
+            os << shown << " ->";
+            const auto& cs = callees.at(name);
+            for (size_t k = 0; k < cs.size(); k++) os << (k ? ", " : " ") << cs[k];
+            if (cs.empty()) os << " (none)";
+            if (recursive.count(name)) os << "  (recursive)";
+            os << "\n";
+        };
+        line("", "<main>");
+        for (const auto& f : prog.functions) line(f.name, f.name);
+        os << "\n";
+    }
+};
+
+// What a pass may look at besides the code it rewrites.
+struct PassContext {
+    const TACProgram& program;
+    const CallGraph& calls;
+};
+
+// Replaces calls to small non-recursive functions by a renamed copy of the
+// callee's body. Cost model, in TAC instructions: the body costs its size, the
+// call saves its params + call + return, and a constant argument is worth a
+// few more because the copy can fold on it. A call is inlined when that net
+// cost fits a budget that doubles per loop level around the call (where the
+// call runs most), or when it is the callee's only call site; a caller never
+// grows by more than MAX_GROWTH instructions. Callees are optimized (and
+// inlined into) before their callers, so the size seen is the final one.
+class Inliner {
+    static const int BASE_BUDGET = 24;
+    static const int CONST_ARG_BONUS = 3;
+    static const int MAX_SINGLE_SITE = 400;
+    static const size_t MAX_GROWTH = 2000;
+
+    int nextTemp = 0, nextLabel = 0;
+
+    // Loop nesting of each instruction: how many backward jumps cover it
+    // (while loops are laid out as 'Lbegin: ... goto Lbegin').
+    static vector<int> loopDepth(const vector<TACInstr>& code) {
+        unordered_map<string, size_t> at;
+        for (size_t k = 0; k < code.size(); k++)
+            if (code[k].kind == TACKind::Label) at[code[k].label] = k;
+        vector<int> d(code.size() + 1, 0);
+        for (size_t k = 0; k < code.size(); k++) {
+            if (!tacIsJump(code[k])) continue;
+            auto it = at.find(code[k].label);
+            if (it != at.end() && it->second < k) { d[it->second]++; d[k + 1]--; }
+        }
+        for (size_t k = 1; k < d.size(); k++) d[k] += d[k - 1];
+        return d;
+    }
+
+    static size_t bodySize(const TACFunction& f) {
+        size_t n = 0;
+        for (const auto& in : f.code) n += in.kind != TACKind::Label;
+        return n;
+    }
+
+    static bool worthInlining(const TACFunction& f, const vector<string>& args, int depth, const CallGraph& cg) {
+        if (cg.recursive.count(f.name)) return false;
+        long long size = (long long)bodySize(f);
+        if (cg.callSites.at(f.name) == 1 && size <= MAX_SINGLE_SITE) return true;
+        long long cost = size - (long long)(args.size() + 2);
+        for (const auto& a : args) cost -= isNameOperand(a) ? 0 : CONST_ARG_BONUS;
+        return cost <= (long long)BASE_BUDGET << min(depth, 3);
+    }
+
+    //   p1' = arg1 ; ... ; x' = 0 (locals read before written) ; body' ; dst = v
+    vector<TACInstr> expand(const TACFunction& f, const vector<string>& args, const string& dst) {
+        unordered_map<string, string> names, labels;
+        auto name = [&](const string& x) -> string {
+            if (!isNameOperand(x)) return x;
+            auto it = names.find(x);
+            if (it != names.end()) return it->second;
+            return names[x] = TEMP_PREFIX + to_string(++nextTemp);
+        };
+        auto label = [&](const string& l) -> string {
+            auto it = labels.find(l);
+            if (it != labels.end()) return it->second;
+            return labels[l] = LABEL_PREFIX + to_string(++nextLabel);
+        };
+
+        vector<TACInstr> out;
+        for (size_t k = 0; k < f.params.size(); k++) out.push_back({TACKind::Copy, name(f.params[k]), args[k], "", ""});
+        CFG cfg(f.code);
+        Liveness live(cfg);
+        vector<string> uninit;
+        for (const auto& x : live.in[0])
+            if (find(f.params.begin(), f.params.end(), x) == f.params.end()) uninit.push_back(x);
+        sort(uninit.begin(), uninit.end());
+        for (const auto& x : uninit) out.push_back({TACKind::Copy, name(x), "0", "", ""});
+
+        for (auto in : f.code) {
+            if (in.kind == TACKind::Return) {
+                out.push_back({TACKind::Copy, dst, name(in.a), "", ""});
+                continue;
+            }
+            forEachUse(in, [&](string& x) { x = name(x); });
+            if (tacDefines(in)) in.dst = name(in.dst);
+            if (in.kind == TACKind::Label || tacIsJump(in)) in.label = label(in.label);
+            out.push_back(std::move(in));
+        }
+        return out;
+    }
+
+public:
+    void run(vector<TACInstr>& code, const PassContext& ctx) {
+        vector<int> depth = loopDepth(code);
+        nextTemp = maxNumbered(code, TEMP_PREFIX);
+        nextLabel = maxNumbered(code, LABEL_PREFIX);
+        size_t grown = 0;
+
+        vector<TACInstr> out;
+        out.reserve(code.size());
+        for (size_t k = 0; k < code.size(); k++) {
+            auto& in = code[k];
+            auto it = in.kind == TACKind::Call ? ctx.calls.indexOf.find(in.label) : ctx.calls.indexOf.end();
+            if (it != ctx.calls.indexOf.end()) {
+                const TACFunction& f = ctx.program.functions[it->second];
+                size_t argc = f.params.size();
+                bool paramsBefore = out.size() >= argc;
+                for (size_t j = out.size() - min(argc, out.size()); j < out.size(); j++)
+                    paramsBefore = paramsBefore && out[j].kind == TACKind::Param;
+                vector<string> args;
+                if (paramsBefore)
+                    for (size_t j = out.size() - argc; j < out.size(); j++) args.push_back(out[j].a);
+                if (paramsBefore && grown + bodySize(f) <= MAX_GROWTH && worthInlining(f, args, depth[k], ctx.calls)) {
+                    out.resize(out.size() - argc);
+                    auto body = expand(f, args, in.dst);
+                    grown += body.size();
+                    for (auto& x : body) out.push_back(std::move(x));
+                    continue;
+                }
+            }
+            out.push_back(std::move(in));
+        }
+        code.swap(out);
+    }
+};
+
+// After inlining, functions the top level no longer reaches are dropped.
+static void removeUncalledFunctions(TACProgram& prog) {
+    CallGraph cg(prog);
+    unordered_set<string> reached;
+    vector<string> work{""};
+    while (!work.empty()) {
+        string f = work.back();
+        work.pop_back();
+        for (const auto& g : cg.callees.at(f))
+            if (reached.insert(g).second) work.push_back(g);
+    }
+    vector<TACFunction> kept;
+    for (auto& f : prog.functions)
+        if (reached.count(f.name)) kept.push_back(std::move(f));
+    prog.functions.swap(kept);
+}
+
+// =========================================================
+// 6c) SLP VECTORIZATION
+// =========================================================
+// Superword-level parallelism inside a basic block: stores to consecutive
+// elements of one array (a[i], a[i+1], ...) whose values are computed by
+// isomorphic expression trees are packed into vector instructions, e.g.
+//   c[0] = a[0] * b[0] + x ; ... ; c[3] = a[3] * b[3] + x
+// becomes vload a, vload b, *, splat x, +, vstore c (x4). Lanes come in
+// groups of 8 (AVX2 width) or 4 (SSE width); how the VM executes them is
+// its business (section 8). A tree node is packed when every lane has the
+// same operand (splat), or every lane's value is a single-use temp computed
+// by the same +, - or * (recursively) or by loads of consecutive elements of
+// one array. The packed code replaces the last store of the group, so the
+// pass checks that nothing in between redefines a name the vector code
+// reads and that no moved load or store changes which value an access sees.
+// A group is only rewritten when it needs fewer instructions than the
+// scalar code. Runs on non-SSA code as the very last pass.
+class SLPVectorizer {
+    static const int MIN_WIDTH = 4, MAX_WIDTH = 8;
+
+    // An index as base + off; an empty base means the literal off.
+    struct Addr {
+        string base;
+        long long off;
+    };
+
+    struct Access {
+        string arr;
+        Addr at;
+        size_t pos;
+        bool store;
+    };
+
+    struct Pack {
+        vector<size_t> members;                 // block positions it replaces
+        vector<TACInstr> code;
+        vector<pair<string, size_t>> reads;     // name read by the vector code, position of the original read
+        vector<string> bases;                   // index bases that must not change
+        vector<Access> accesses;
+        size_t first = SIZE_MAX;                // earliest member
+        size_t basesFrom = SIZE_MAX;            // earliest member or index computation
+        bool ok = true;
+    };
+
+    const vector<TACInstr>* bc = nullptr;
+    unordered_map<string, int> uses, defs;      // in the whole unit
+    unordered_map<string, vector<size_t>> defAt; // in the current block, ascending
+    vector<bool> claimed;
+    int nextVec = 0;
+
+    long long lastDefBefore(const string& x, size_t pos) const {
+        auto it = defAt.find(x);
+        if (it == defAt.end()) return -1;
+        auto p = lower_bound(it->second.begin(), it->second.end(), pos);
+        return p == it->second.begin() ? -1 : (long long)*(p - 1);
+    }
+
+    bool definedIn(const string& x, size_t lo, size_t hi) const {   // any definition at lo..hi
+        auto it = defAt.find(x);
+        if (it == defAt.end()) return false;
+        auto p = lower_bound(it->second.begin(), it->second.end(), lo);
+        return p != it->second.end() && *p <= hi;
+    }
+
+    // i, i + c, c + i, i - c as seen at 'pos'; the base of i + c is i.
+    Addr addrOf(const string& x, size_t pos, size_t& lo) const {
+        int32_t v;
+        if (parseIntLiteral(x, v)) return {"", v};
+        long long d = lastDefBefore(x, pos);
+        if (d >= 0) {
+            const TACInstr& in = (*bc)[(size_t)d];
+            int32_t c;
+            if (in.kind == TACKind::Binary && (in.op == "+" || in.op == "-")) {
+                if (isNameOperand(in.a) && parseIntLiteral(in.b, c)) {
+                    lo = min(lo, (size_t)d);
+                    return {in.a, in.op == "+" ? (long long)c : -(long long)c};
+                }
+                if (in.op == "+" && parseIntLiteral(in.a, c) && isNameOperand(in.b)) {
+                    lo = min(lo, (size_t)d);
+                    return {in.b, c};
+                }
+            }
+        }
+        return {x, 0};
+    }
+
+    string freshVec() { return VEC_PREFIX + to_string(++nextVec); }
+
+    void addMember(Pack& pk, size_t pos) {
+        if (claimed[pos]) pk.ok = false;
+        pk.members.push_back(pos);
+        pk.first = min(pk.first, pos);
+    }
+
+    // vals[j] is what lane j needs, read by the instruction at readAt[j].
+    string pack(const vector<string>& vals, const vector<size_t>& readAt, Pack& pk) {
+        if (!pk.ok) return "";
+        int w = (int)vals.size();
+        if (all_of(vals.begin(), vals.end(), [&](const string& x) { return x == vals[0]; })) {
+            if (isNameOperand(vals[0])) pk.reads.push_back({vals[0], *min_element(readAt.begin(), readAt.end())});
+            string v = freshVec();
+            TACInstr in{TACKind::VSplat, v, vals[0], "", ""};
+            in.width = w;
+            pk.code.push_back(in);
+            return v;
+        }
+
+        // Every lane: a single-use temp defined once, earlier in this block, by the same kind of instruction.
+        vector<size_t> at(w);
+        for (int j = 0; j < w; j++) {
+            const string& x = vals[j];
+            if (!isNameOperand(x) || uses[x] != 1 || defs[x] != 1) { pk.ok = false; return ""; }
+            long long d = lastDefBefore(x, readAt[j]);
+            if (d < 0) { pk.ok = false; return ""; }
+            at[j] = (size_t)d;
+        }
+        const TACInstr& d0 = (*bc)[at[0]];
+        for (int j = 0; j < w; j++) {
+            const TACInstr& dj = (*bc)[at[j]];
+            if (dj.kind != d0.kind || dj.op != d0.op || dj.label != d0.label) { pk.ok = false; return ""; }
+        }
+        for (size_t p : at) addMember(pk, p);
+
+        if (d0.kind == TACKind::Binary && (d0.op == "+" || d0.op == "-" || d0.op == "*")) {
+            vector<string> as, bs;
+            for (size_t p : at) { as.push_back((*bc)[p].a); bs.push_back((*bc)[p].b); }
+            string va = pack(as, at, pk);
+            string vb = pack(bs, at, pk);
+            if (!pk.ok) return "";
+            string v = freshVec();
+            TACInstr in{TACKind::VBinary, v, va, vb, d0.op};
+            in.width = w;
+            pk.code.push_back(in);
+            return v;
+        }
+        if (d0.kind == TACKind::Load) {
+            vector<Access> lanes;
+            if (!consecutive(at, false, lanes, pk)) { pk.ok = false; return ""; }
+            string v = freshVec();
+            TACInstr in{TACKind::VLoad, v, d0.a, "", "", d0.label};
+            in.width = w;
+            pk.code.push_back(in);
+            return v;
+        }
+        pk.ok = false;
+        return "";
+    }
+
+    // The loads/stores at 'at' access arr[base + off0 + j] for lane j.
+    bool consecutive(const vector<size_t>& at, bool store, vector<Access>& lanes, Pack& pk) {
+        size_t lo = SIZE_MAX;
+        for (size_t j = 0; j < at.size(); j++) {
+            const TACInstr& in = (*bc)[at[j]];
+            lanes.push_back({in.label, addrOf(in.a, at[j], lo), at[j], store});
+            if (lanes[j].at.base != lanes[0].at.base || lanes[j].at.off != lanes[0].at.off + (long long)j) return false;
+        }
+        const string& i0 = (*bc)[at[0]].a;
+        if (isNameOperand(i0)) pk.reads.push_back({i0, at[0]});
+        if (!lanes[0].at.base.empty()) pk.bases.push_back(lanes[0].at.base);
+        pk.basesFrom = min({pk.basesFrom, pk.first, lo});
+        for (auto& a : lanes) pk.accesses.push_back(a);
+        return true;
+    }
+
+    static bool sameElement(const Access& x, const Access& y) { return x.arr == y.arr && x.at.base == y.at.base && x.at.off == y.at.off; }
+
+    // The vector code runs at 'last' in place of all members.
+    bool legal(const Pack& pk, size_t last) const {
+        for (const auto& r : pk.reads)
+            if (definedIn(r.first, r.second + 1, last)) return false;
+        for (const auto& b : pk.bases)
+            if (definedIn(b, min(pk.basesFrom, pk.first), last)) return false;
+
+        unordered_set<size_t> member(pk.members.begin(), pk.members.end());
+        unordered_set<string> loaded, stored;
+        for (const auto& a : pk.accesses) (a.store ? stored : loaded).insert(a.arr);
+        for (size_t p = pk.first; p <= last; p++) {
+            const TACInstr& in = (*bc)[p];
+            if (in.kind == TACKind::Call) return false;
+            if (member.count(p)) continue;
+            // Other memory accesses keep their place, so they must not touch what the pack moves.
+            if (in.kind == TACKind::Store && (loaded.count(in.label) || stored.count(in.label))) return false;
+            if (in.kind == TACKind::Load && stored.count(in.label)) return false;
+        }
+        // Inside the pack, loads now run before all stores: a load must not
+        // have seen an element stored earlier by the pack itself.
+        for (const auto& s : pk.accesses) {
+            if (!s.store) continue;
+            for (const auto& l : pk.accesses) {
+                if (l.store || l.arr != s.arr) continue;
+                if (l.at.base != s.at.base) return false;
+                if (l.at.off == s.at.off && l.pos > s.pos) return false;
+            }
+        }
+        return true;
+    }
+
+    vector<TACInstr> runBlock(vector<TACInstr>& code) {
+        bc = &code;
+        defAt.clear();
+        for (size_t p = 0; p < code.size(); p++)
+            if (tacDefines(code[p])) defAt[code[p].dst].push_back(p);
+        claimed.assign(code.size(), false);
+
+        // Stores by (array, index base), in order of offset.
+        map<pair<string, string>, vector<pair<long long, size_t>>> groups;
+        for (size_t p = 0; p < code.size(); p++) {
+            if (code[p].kind != TACKind::Store) continue;
+            size_t lo = SIZE_MAX;
+            Addr a = addrOf(code[p].a, p, lo);
+            groups[{code[p].label, a.base}].push_back({a.off, p});
+        }
+
+        map<size_t, vector<TACInstr>> emitAt;   // position of the group's last store -> vector code
+        for (auto& g : groups) {
+            auto& st = g.second;
+            sort(st.begin(), st.end());
+            size_t k = 0;
+            while (k < st.size()) {
+                size_t run = 1;
+                while (k + run < st.size() && st[k + run].first == st[k].first + (long long)run) run++;
+                size_t used = run;
+                for (size_t j = k; run - (j - k) >= (size_t)MIN_WIDTH;) {
+                    int w = run - (j - k) >= (size_t)MAX_WIDTH ? MAX_WIDTH : MIN_WIDTH;
+                    tryGroup(st, j, w, emitAt);
+                    j += w;
+                }
+                k += used;
+            }
+        }
+        if (emitAt.empty()) return std::move(code);
+
+        vector<TACInstr> out;
+        for (size_t p = 0; p < code.size(); p++) {
+            auto it = emitAt.find(p);
+            if (it != emitAt.end())
+                for (auto& in : it->second) out.push_back(std::move(in));
+            else if (!claimed[p]) out.push_back(std::move(code[p]));
+        }
+        return out;
+    }
+
+    void tryGroup(const vector<pair<long long, size_t>>& st, size_t j, int w, map<size_t, vector<TACInstr>>& emitAt) {
+        Pack pk;
+        vector<size_t> at;
+        vector<string> vals;
+        for (int l = 0; l < w; l++) {
+            size_t p = st[j + l].second;
+            addMember(pk, p);
+            at.push_back(p);
+            vals.push_back((*bc)[p].b);
+        }
+        vector<Access> lanes;
+        if (!consecutive(at, true, lanes, pk)) return;
+        int saveVec = nextVec;
+        string v = pack(vals, at, pk);
+        size_t last = *max_element(at.begin(), at.end());
+        if (!pk.ok || !legal(pk, last) || pk.code.size() + 1 >= pk.members.size()) {
+            nextVec = saveVec;
+            return;
+        }
+        TACInstr in{TACKind::VStore, "", (*bc)[at[0]].a, v, "", (*bc)[at[0]].label};
+        in.width = w;
+        pk.code.push_back(in);
+        for (size_t p : pk.members) claimed[p] = true;
+        emitAt[last] = std::move(pk.code);
+    }
+
+public:
+    void run(vector<TACInstr>& code) {
+        uses.clear();
+        defs.clear();
+        for (const auto& in : code) {
+            forEachUse(in, [&](const string& x) { if (isNameOperand(x)) uses[x]++; });
+            if (tacDefines(in)) defs[in.dst]++;
+        }
+        nextVec = maxNumbered(code, VEC_PREFIX);
+
+        CFG cfg(std::move(code));
+        bool changed = false;
+        for (auto& bb : cfg.blocks) {
+            size_t before = bb.code.size();
+            bb.code = runBlock(bb.code);
+            changed = changed || bb.code.size() != before;
+        }
+        code = cfg.flatten();
+        if (changed) DeadCodeEliminator().run(code);   // index temps of the packed lanes
+    }
+};
+
+// =========================================================
+// 7) PASS MANAGER
+// =========================================================
+// Runs registered passes in order over every function (callees first, see
+// CallGraph) and then the top level, recording time and instruction count
+// before/after each pass, summed over all units. Passes flagged as SSA passes
+// get the code in SSA form: the manager builds SSA before the first of them
+// and converts back after the last one (both steps are timed too).
+class PassManager {
+public:
+    using PassFn = function<void(vector<TACInstr>&, const PassContext&)>;
+
+    struct Timing {
+        string name;
+        double ms;
+        size_t before, after;
+    };
+
+private:
+    struct Pass {
+        string name;
+        bool ssa;
+        PassFn fn;
+    };
+
+    vector<Pass> passes;
+    vector<Timing> timings;
+    bool dumpSSA = false;
+    TACProgram ssaForm;   // filled unit by unit when dumpSSA is on
+    bool trackFootprint = false;
+    size_t otherUnitsBytes = 0, peakBytes = 0;   // TAC footprint of the units not being optimized, peak of the whole
+
+    void timed(const string& name, const PassFn& fn, vector<TACInstr>& code, const PassContext& ctx) {
+        checkTimeBudget(("optimization (" + name + ")").c_str());
+        size_t before = code.size();
+        auto t0 = chrono::steady_clock::now();
+        fn(code, ctx);
+        auto t1 = chrono::steady_clock::now();
+        if (trackFootprint) peakBytes = max(peakBytes, otherUnitsBytes + footprint(code));
+        double ms = chrono::duration<double, milli>(t1 - t0).count();
+        for (auto& t : timings) {
+            if (t.name != name) continue;
+            t.ms += ms;
+            t.before += before;
+            t.after += code.size();
+            return;
+        }
+        timings.push_back({name, ms, before, code.size()});
+    }
+
+    void enterSSA(vector<TACInstr>& code, const PassContext& ctx) {
+        timed("ssa-build", [](vector<TACInstr>& c, const PassContext&) { SSABuilder().run(c); }, code, ctx);
+    }
+
+    void leaveSSA(vector<TACInstr>& code, const PassContext& ctx, vector<TACInstr>* ssaOut) {
+        if (ssaOut) *ssaOut = code;
+        timed("ssa-destroy", [](vector<TACInstr>& c, const PassContext&) { SSADestructor().run(c); }, code, ctx);
+    }
+
+    void runUnit(vector<TACInstr>& code, const PassContext& ctx, vector<TACInstr>* ssaOut) {
+        if (trackFootprint) otherUnitsBytes -= footprint(code);
+        bool inSSA = false, sawSSA = false;
+        for (const auto& p : passes) {
+            if (p.ssa && !inSSA) { enterSSA(code, ctx); inSSA = sawSSA = true; }
+            if (!p.ssa && inSSA) { leaveSSA(code, ctx, ssaOut); inSSA = false; }
+            timed(p.name, p.fn, code, ctx);
+        }
+        if (!sawSSA && ssaOut) { enterSSA(code, ctx); inSSA = true; }
+        if (inSSA) leaveSSA(code, ctx, ssaOut);
+        if (trackFootprint) otherUnitsBytes += footprint(code);
+    }
+
+public:
+    void add(const string& name, bool ssa, PassFn fn) { passes.push_back({name, ssa, std::move(fn)}); }
+    void setDumpSSA(bool on) { dumpSSA = on; }
+    // Measure the TAC footprint after every pass (costs a walk over the unit).
+    void setTrackFootprint(bool on) { trackFootprint = on; }
+    bool empty() const { return passes.empty(); }
+
+    bool has(const string& name) const {
+        for (const auto& p : passes)
+            if (p.name == name) return true;
+        return false;
+    }
+
+    void run(TACProgram& prog) {
+        timings.clear();
+        if (trackFootprint) otherUnitsBytes = peakBytes = footprint(prog);
+        if (dumpSSA) ssaForm = prog;
+        CallGraph cg(prog);
+        PassContext ctx{prog, cg};
+        for (const auto& name : cg.bottomUp) {
+            size_t k = cg.indexOf.at(name);
+            runUnit(prog.functions[k].code, ctx, dumpSSA ? &ssaForm.functions[k].code : nullptr);
+        }
+        runUnit(prog.main, ctx, dumpSSA ? &ssaForm.main : nullptr);
+    }
+
+    const vector<Timing>& report() const { return timings; }
+    const TACProgram& ssa() const { return ssaForm; }
+    size_t peakFootprint() const { return peakBytes; }
+};
+
+// Every optimization the driver knows about, in pipeline order.
+// 'level' is the lowest -O level that runs the pass by default.
+struct PassInfo {
+    const char* name;
+    int level;
+    bool ssa;
+    PassManager::PassFn fn;
+};
+
+static const vector<PassInfo>& passRegistry() {
+    static const vector<PassInfo> reg = {
+        {"inline",    2, false, [](vector<TACInstr>& c, const PassContext& ctx) { Inliner().run(c, ctx); }},
+        {"constprop", 1, false, [](vector<TACInstr>& c, const PassContext&) { ConstantPropagator().run(c); }},
+        {"dce",       1, false, [](vector<TACInstr>& c, const PassContext&) { DeadCodeEliminator().run(c); }},
+        {"reassoc",   2, true,  [](vector<TACInstr>& c, const PassContext&) { Reassociator().run(c); }},
+        {"sccp",      2, true,  [](vector<TACInstr>& c, const PassContext&) { SCCP().run(c); }},
+        {"bce",       2, true,  [](vector<TACInstr>& c, const PassContext&) { BoundsCheckEliminator().run(c); }},
+        {"licm",      2, true,  [](vector<TACInstr>& c, const PassContext&) { LICM().run(c); }},
+        {"iv-sr",     2, true,  [](vector<TACInstr>& c, const PassContext&) { IVStrengthReduction().run(c); }},
+        {"gvn",       2, true,  [](vector<TACInstr>& c, const PassContext&) { GVN().run(c); }},
+        {"ssa-dce",   2, true,  [](vector<TACInstr>& c, const PassContext&) { SSADeadCodeEliminator().run(c); }},
+        {"slp",       2, false, [](vector<TACInstr>& c, const PassContext&) { SLPVectorizer().run(c); }},
+    };
+    return reg;
+}
+
+static bool isKnownPass(const string& name) {
+    for (const auto& p : passRegistry())
+        if (name == p.name) return true;
+    return false;
+}
+
+// -O preset first, then --enable-pass / --disable-pass overrides (disable wins).
+static void buildPipeline(PassManager& pm, int level, const vector<string>& enable, const vector<string>& disable) {
+    auto listed = [](const vector<string>& v, const char* name) { return find(v.begin(), v.end(), name) != v.end(); };
+    for (const auto& p : passRegistry()) {
+        bool on = p.level <= level || listed(enable, p.name);
+        if (on && !listed(disable, p.name)) pm.add(p.name, p.ssa, p.fn);
+    }
+}
+
+// =========================================================
+// 8) VIRTUAL MACHINE (TAC interpreter)
+// =========================================================
+// TAC is translated once into a compact register program: every name and
+// every literal of a unit (function or top level) gets a slot of that unit's
+// frame (literal slots are preloaded with their value, parameters come
+// first) and labels become instruction indices, so the dispatch loop never
+// touches a string. Functions are laid out first and the top level last, so
+// running off the end stops the program. Frames live back to back on one
+// stack. Arrays live back to back in one zeroed memory vector, each at the
+// base offset it got on first use. Arithmetic follows the folding rules of
+// section 5; division by zero, a failed bounds check and runaway recursion
+// stop the program with a runtime error. Load/Store themselves do not check:
+// that is what the Check instructions (and the passes that prove them
+// redundant) are for.
+// Lane-wise kernels for the VM's vector instructions, wrapping around like
+// the scalar ops. The widest level the CPU supports is picked once: AVX2,
+// else SSE2 (always present on x86-64), else plain loops. MINI_VM_SIMD=
+// scalar|sse2 forces a lower level.
+enum class VecLevel { Scalar, SSE2, AVX2 };
+
+using VecKernel = void (*)(int32_t* d, const int32_t* a, const int32_t* b, int lanes);
+
+struct VecKernels {
+    VecLevel level;
+    VecKernel add, sub, mul;
+};
+
+struct VecAdd {
+    static uint32_t lane(uint32_t x, uint32_t y) { return x + y; }
+#ifdef MINI_X86_SIMD
+    static __m128i v4(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+    __attribute__((target("avx2"))) static __m256i v8(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+#endif
+};
+
+struct VecSub {
+    static uint32_t lane(uint32_t x, uint32_t y) { return x - y; }
+#ifdef MINI_X86_SIMD
+    static __m128i v4(__m128i x, __m128i y) { return _mm_sub_epi32(x, y); }
+    __attribute__((target("avx2"))) static __m256i v8(__m256i x, __m256i y) { return _mm256_sub_epi32(x, y); }
+#endif
+};
+
+struct VecMul {
+    static uint32_t lane(uint32_t x, uint32_t y) { return x * y; }
+#ifdef MINI_X86_SIMD
+    // SSE2 has no 32-bit low multiply (SSE4.1 does): multiply the even and
+    // the odd lanes as 64-bit products and interleave their low halves.
+    static __m128i v4(__m128i x, __m128i y) {
+        __m128i even = _mm_mul_epu32(x, y);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_srli_epi64(y, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+    __attribute__((target("avx2"))) static __m256i v8(__m256i x, __m256i y) { return _mm256_mullo_epi32(x, y); }
+#endif
+};
+
+template <class Op>
+static void vecScalar(int32_t* d, const int32_t* a, const int32_t* b, int lanes) {
+    for (int k = 0; k < lanes; k++) d[k] = (int32_t)Op::lane((uint32_t)a[k], (uint32_t)b[k]);
+}
+
+#ifdef MINI_X86_SIMD
+template <class Op>
+static void vecSSE2(int32_t* d, const int32_t* a, const int32_t* b, int lanes) {
+    for (int k = 0; k < lanes; k += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + k)), y = _mm_loadu_si128((const __m128i*)(b + k));
+        _mm_storeu_si128((__m128i*)(d + k), Op::v4(x, y));
+    }
+}
+
+template <class Op>
+__attribute__((target("avx2"))) static void vecAVX2(int32_t* d, const int32_t* a, const int32_t* b, int lanes) {
+    if (lanes == 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)a), y = _mm256_loadu_si256((const __m256i*)b);
+        _mm256_storeu_si256((__m256i*)d, Op::v8(x, y));
+        return;
+    }
+    vecSSE2<Op>(d, a, b, lanes);
+}
+#endif
+
+static const VecKernels& vecKernels() {
+    static const VecKernels k = [] {
+        const char* force = getenv("MINI_VM_SIMD");
+        string want = force ? force : "";
+#ifdef MINI_X86_SIMD
+        if (want != "scalar" && want != "sse2" && __builtin_cpu_supports("avx2"))
+            return VecKernels{VecLevel::AVX2, vecAVX2<VecAdd>, vecAVX2<VecSub>, vecAVX2<VecMul>};
+        if (want != "scalar") return VecKernels{VecLevel::SSE2, vecSSE2<VecAdd>, vecSSE2<VecSub>, vecSSE2<VecMul>};
+#endif
+        return VecKernels{VecLevel::Scalar, vecScalar<VecAdd>, vecScalar<VecSub>, vecScalar<VecMul>};
+    }();
+    return k;
+}
+
+static const char* vecLevelName(VecLevel l) {
+    switch (l) {
+        case VecLevel::AVX2: return "avx2";
+        case VecLevel::SSE2: return "sse2";
+        case VecLevel::Scalar: break;
+    }
+    return "scalar";
+}
+
+class VM {
+    enum class Op : uint8_t {
+        Copy, Add, Sub, Mul, Div, Lt, Le, Gt, Ge, Eq, Ne, Print, Jump, JumpIfZero, Load, Store, Check,
+        Param, Call, Return, VLoad, VStore, VAdd, VSub, VMul, VSplat
+    };
+
+    struct Instr {
+        Op op;
+        uint8_t lanes;        // 1, or the width of a vector instruction
+        uint32_t dst, a, b;   // jumps keep their target in dst; Load/Store/Check/Call see run()
+    };
+
+    struct Unit {
+        uint32_t entry = 0;
+        vector<int32_t> initial;   // the frame a call starts with
+    };
+
+    static const size_t MAX_CALL_DEPTH = 100000;
+
+    vector<Instr> prog;
+    vector<Unit> units;   // functions in declaration order, then the top level
+    unordered_map<string, uint32_t> unitOf;
+    unordered_map<string, uint32_t> slots;   // of the unit being translated
+    vector<int32_t> initial;                 // of the unit being translated
+    const unordered_map<string, Symbol>& symbols;
+    unordered_map<string, uint32_t> bases;
+    vector<string> arrayAt;   // memory offset -> array name, for error messages
+    size_t memSize = 0;
+
+    // A vector name gets 'lanes' consecutive slots.
+    uint32_t slotOf(const string& x, int lanes = 1) {
+        auto it = slots.find(x);
+        if (it != slots.end()) return it->second;
+        int32_t v = 0;
+        if (!isNameOperand(x) && !parseIntLiteral(x, v))
+            throw runtime_error("Runtime error: integer literal '" + x + "' does not fit in 32 bits.");
+        slots.emplace(x, (uint32_t)initial.size());
+        initial.resize(initial.size() + (size_t)lanes, v);
+        return (uint32_t)(initial.size() - (size_t)lanes);
+    }
+
+    uint32_t baseOf(const string& arr) {
+        auto it = bases.find(arr);
+        if (it != bases.end()) return it->second;
+        auto sym = symbols.find(arr);
+        if (sym == symbols.end() || sym->second.size == 0)
+            throw runtime_error("Internal error: VM has no array '" + arr + "'.");
+        bases.emplace(arr, (uint32_t)memSize);
+        arrayAt.resize(memSize + (size_t)sym->second.size, arr);
+        memSize += (size_t)sym->second.size;
+        return bases[arr];
+    }
+
+    uint32_t unitNamed(const string& f) const {
+        auto it = unitOf.find(f);
+        if (it == unitOf.end()) throw runtime_error("Internal error: VM has no function '" + f + "'.");
+        return it->second;
+    }
+
+    static Op binaryOp(const string& op) {
+        static const unordered_map<string, Op> ops = {
+            {"+", Op::Add}, {"-", Op::Sub}, {"*", Op::Mul}, {"/", Op::Div}, {"<", Op::Lt}, {"<=", Op::Le},
+            {">", Op::Gt}, {">=", Op::Ge}, {"==", Op::Eq}, {"!=", Op::Ne}};
+        auto it = ops.find(op);
+        if (it == ops.end()) throw runtime_error("Internal error: VM has no operator '" + op + "'.");
+        return it->second;
+    }
+
+    static Op vectorOp(const string& op) {
+        if (op == "+") return Op::VAdd;
+        if (op == "-") return Op::VSub;
+        if (op == "*") return Op::VMul;
+        throw runtime_error("Internal error: VM has no vector operator '" + op + "'.");
+    }
+
+    void translate(const vector<TACInstr>& code, const vector<string>& params, Unit& unit) {
+        slots.clear();
+        initial.clear();
+        for (const auto& p : params) slotOf(p);
+        unit.entry = (uint32_t)prog.size();
+        unordered_map<string, uint32_t> labelAt;
+        size_t k = prog.size();
+        for (const auto& in : code) {
+            if (in.kind == TACKind::Label) labelAt[in.label] = (uint32_t)prog.size();
+            else if (in.kind != TACKind::Phi) prog.push_back({Op::Copy, 1, 0, 0, 0});
+        }
+        for (const auto& in : code) {
+            uint8_t w = (uint8_t)in.width;
+            switch (in.kind) {
+                case TACKind::Label: continue;
+                case TACKind::Phi: throw runtime_error("Internal error: VM cannot run SSA form.");
+                case TACKind::Copy:    prog[k] = {Op::Copy, 1, slotOf(in.dst), slotOf(in.a), 0}; break;
+                case TACKind::Binary:  prog[k] = {binaryOp(in.op), 1, slotOf(in.dst), slotOf(in.a), slotOf(in.b)}; break;
+                case TACKind::Print:   prog[k] = {Op::Print, 1, 0, slotOf(in.a), 0}; break;
+                case TACKind::Goto:    prog[k] = {Op::Jump, 1, labelAt.at(in.label), 0, 0}; break;
+                case TACKind::IfFalse: prog[k] = {Op::JumpIfZero, 1, labelAt.at(in.label), slotOf(in.a), 0}; break;
+                case TACKind::Load:    prog[k] = {Op::Load, 1, slotOf(in.dst), slotOf(in.a), baseOf(in.label)}; break;
+                case TACKind::Store:   prog[k] = {Op::Store, 1, baseOf(in.label), slotOf(in.a), slotOf(in.b)}; break;
+                case TACKind::Check:   prog[k] = {Op::Check, 1, (uint32_t)atoi(in.b.c_str()), slotOf(in.a), baseOf(in.label)}; break;
+                case TACKind::Param:   prog[k] = {Op::Param, 1, 0, slotOf(in.a), 0}; break;
+                case TACKind::Call:    prog[k] = {Op::Call, 1, slotOf(in.dst), unitNamed(in.label), (uint32_t)atoi(in.b.c_str())}; break;
+                case TACKind::Return:  prog[k] = {Op::Return, 1, 0, slotOf(in.a), 0}; break;
+                case TACKind::VLoad:   prog[k] = {Op::VLoad, w, slotOf(in.dst, w), slotOf(in.a), baseOf(in.label)}; break;
+                case TACKind::VStore:  prog[k] = {Op::VStore, w, baseOf(in.label), slotOf(in.a), slotOf(in.b, w)}; break;
+                case TACKind::VBinary: prog[k] = {vectorOp(in.op), w, slotOf(in.dst, w), slotOf(in.a, w), slotOf(in.b, w)}; break;
+                case TACKind::VSplat:  prog[k] = {Op::VSplat, w, slotOf(in.dst, w), slotOf(in.a), 0}; break;
+            }
+            k++;
+        }
+        unit.initial.swap(initial);
+    }
+
+public:
+    VM(const TACProgram& tac, const unordered_map<string, Symbol>& syms) : symbols(syms) {
+        units.resize(tac.functions.size() + 1);
+        for (size_t k = 0; k < tac.functions.size(); k++) unitOf[tac.functions[k].name] = (uint32_t)k;
+        for (size_t k = 0; k < tac.functions.size(); k++) translate(tac.functions[k].code, tac.functions[k].params, units[k]);
+        translate(tac.main, {}, units.back());
+    }
+
+    // Runs to completion, writing one printed value per line; returns the number of executed instructions.
+    //   Load : r[dst] = mem[b + r[a]]      Store : mem[dst + r[a]] = r[b]
+    //   Check: r[a] in [0, dst), b is the array's base (only for the message)
+    //   Param: push r[a]                   Call  : r[dst] = unit a called with the last b pushed values
+    //   VLoad: r[dst..] = mem[b + r[a]..]  VStore: mem[dst + r[a]..] = r[b..]   (vector ops cover 'lanes' slots)
+    uint64_t run(ostream& out) const {
+        const VecKernels& vk = vecKernels();
+        struct Frame {
+            size_t base, retPc;
+            uint32_t dst;
+        };
+        vector<Frame> frames;
+        vector<int32_t> args;
+        vector<int32_t> stack = units.back().initial;
+        int32_t* r = stack.data();
+        vector<int32_t> mem(memSize, 0);
+        uint64_t steps = 0;
+        size_t base = 0, pc = units.back().entry, n = prog.size();
+        while (pc < n) {
+            const Instr& in = prog[pc++];
+            if (++steps % (LIMIT_CHECK_EVERY * 64) == 0) checkTimeBudget("execution");
+            auto u = [&](uint32_t slot) { return (uint32_t)r[slot]; };   // wrap-around view of a slot
+            switch (in.op) {
+                case Op::Copy: r[in.dst] = r[in.a]; break;
+                case Op::Add:  r[in.dst] = (int32_t)(u(in.a) + u(in.b)); break;
+                case Op::Sub:  r[in.dst] = (int32_t)(u(in.a) - u(in.b)); break;
+                case Op::Mul:  r[in.dst] = (int32_t)(u(in.a) * u(in.b)); break;
+                case Op::Div:
+                    if (r[in.b] == 0) throw runtime_error("Runtime error: division by zero.");
+                    r[in.dst] = (r[in.a] == INT32_MIN && r[in.b] == -1) ? INT32_MIN : r[in.a] / r[in.b];
+                    break;
+                case Op::Lt: r[in.dst] = r[in.a] < r[in.b]; break;
+                case Op::Le: r[in.dst] = r[in.a] <= r[in.b]; break;
+                case Op::Gt: r[in.dst] = r[in.a] > r[in.b]; break;
+                case Op::Ge: r[in.dst] = r[in.a] >= r[in.b]; break;
+                case Op::Eq: r[in.dst] = r[in.a] == r[in.b]; break;
+                case Op::Ne: r[in.dst] = r[in.a] != r[in.b]; break;
+                case Op::Print: out << r[in.a] << "\n"; break;
+                case Op::Jump: pc = in.dst; break;
+                case Op::JumpIfZero: if (r[in.a] == 0) pc = in.dst; break;
+                case Op::Load:  r[in.dst] = mem[in.b + u(in.a)]; break;
+                case Op::Store: mem[in.dst + u(in.a)] = r[in.b]; break;
+                case Op::Check:
+                    if (u(in.a) >= in.dst) {
+                        throw runtime_error("Runtime error: index " + to_string(r[in.a]) + " is out of bounds for '" +
+                                            arrayAt[in.b] + "[" + to_string(in.dst) + "]'.");
+                    }
+                    break;
+                case Op::Param: args.push_back(r[in.a]); break;
+                case Op::Call: {
+                    if (frames.size() >= MAX_CALL_DEPTH)
+                        throw runtime_error("Runtime error: call stack overflow (more than " +
+                                            to_string(MAX_CALL_DEPTH) + " nested calls).");
+                    const Unit& callee = units[in.a];
+                    frames.push_back({base, pc, in.dst});
+                    base = stack.size();
+                    stack.insert(stack.end(), callee.initial.begin(), callee.initial.end());
+                    copy(args.end() - in.b, args.end(), stack.begin() + (ptrdiff_t)base);
+                    args.resize(args.size() - in.b);
+                    r = stack.data() + base;
+                    pc = callee.entry;
+                    break;
+                }
+                case Op::VLoad:  memcpy(r + in.dst, &mem[in.b + u(in.a)], in.lanes * sizeof(int32_t)); break;
+                case Op::VStore: memcpy(&mem[in.dst + u(in.a)], r + in.b, in.lanes * sizeof(int32_t)); break;
+                case Op::VAdd:   vk.add(r + in.dst, r + in.a, r + in.b, in.lanes); break;
+                case Op::VSub:   vk.sub(r + in.dst, r + in.a, r + in.b, in.lanes); break;
+                case Op::VMul:   vk.mul(r + in.dst, r + in.a, r + in.b, in.lanes); break;
+                case Op::VSplat: fill(r + in.dst, r + in.dst + in.lanes, r[in.a]); break;
+                case Op::Return: {
+                    int32_t v = r[in.a];
+                    Frame f = frames.back();
+                    frames.pop_back();
+                    stack.resize(base);
+                    base = f.base;
+                    r = stack.data() + base;
+                    r[f.dst] = v;
+                    pc = f.retPc;
+                    break;
+                }
+            }
+        }
+        return steps;
+    }
+};
+
+// =========================================================
+// OUTPUT HELPERS (Exam format)
+// =========================================================
+static void printTokens(const vector<Token>& toks) {
+    cout << "TOKENS:\n";
+    for (const auto& tk : toks) {
+        if (tk.type == TokenType::END) break; // keep output clean
+        cout << left << setw(10) << tk.lexeme << " " << tokenCategory(tk.type) << "\n";
+    }
     cout << "\n";
 }
 
-int main() {
-    try {
-        // Read entire source program from stdin
+static void printSymbolTable(const SemanticAnalyzer& sem) {
+    cout << "SYMBOL TABLE:\n";
+    cout << left << setw(10) << "Name" << "Type\n";
+    for (const auto& name : sem.symbolOrder()) {
+        cout << left << setw(10) << name << sem.symbols().at(name).type << "\n";
+    }
+    cout << "\n";
+}
+
+// Each function between "func f(a, b):" and "endfunc", then the top level.
+static void printTAC(const TACProgram& tac, const char* title = "INTERMEDIATE CODE (TAC):") {
+    cout << title << "\n";
+    for (const auto& f : tac.functions) {
+        cout << "func " << f.name << "(";
+        for (size_t k = 0; k < f.params.size(); k++) cout << (k ? ", " : "") << f.params[k];
+        cout << "):\n";
+        for (const auto& in : f.code) cout << tacToString(in) << "\n";
+        cout << "endfunc\n";
+    }
+    for (const auto& in : tac.main) cout << tacToString(in) << "\n";
+    cout << "\n";
+}
+
+// Machine-readable "key value" lines for --stats, printed on stderr (in the
+// order they were added) so stdout keeps the exam format.
+class Stats {
+    vector<pair<string, string>> rows;
+
+public:
+    void add(const string& key, long long v) { rows.push_back({key, to_string(v)}); }
+    void add(const string& key, const string& v) { rows.push_back({key, v}); }
+    void add(const string& key, double v, int precision, const char* suffix = "") {
         ostringstream oss;
-        oss << cin.rdbuf();
-        string src = oss.str();
+        oss << fixed << setprecision(precision) << v << suffix;
+        rows.push_back({key, oss.str()});
+    }
 
-        // Phase 1: Lexer
-        Lexer lexer(src);
-        auto tokens = lexer.tokenize();
-        printTokens(tokens);
+    void print(ostream& os) const {
+        os << "STATS:\n";
+        for (const auto& r : rows) os << left << setw(23) << r.first << " " << r.second << "\n";
+    }
+};
+
+// Adds "phase.<name>.ms" with the wall time of its scope.
+class PhaseTimer {
+    Stats& st;
+    const char* name;
+    chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+
+public:
+    PhaseTimer(Stats& stats, const char* phase) : st(stats), name(phase) {}
+    ~PhaseTimer() {
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+        st.add(string("phase.") + name + ".ms", ms, 3);
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
+
+static void addOptimizationStats(Stats& st, size_t tacCount, size_t optCount, const PassManager& pm) {
+    double reduced = tacCount ? 100.0 * (double)(tacCount - optCount) / (double)tacCount : 0.0;
+    st.add("tac.instructions", (long long)tacCount);
+    st.add("opt.instructions", (long long)optCount);
+    st.add("opt.reduction", reduced, 1, "%");
+    for (const auto& t : pm.report()) {
+        st.add("pass." + t.name + ".ms", t.ms, 3);
+        st.add("pass." + t.name + ".delta", (long long)t.after - (long long)t.before);
+    }
+}
+
+// Bytes held by each data structure once built (the optimized TAC also at its
+// peak across passes) and the process peak RSS.
+static void addFootprintStats(Stats& st, const vector<Token>& tokens, const Program& ast, const SemanticAnalyzer& sem,
+                              const TACProgram& tac, const TACProgram& opt, const PassManager& pm) {
+    st.add("mem.tokens.bytes", (long long)footprint(tokens));
+    st.add("mem.ast.bytes", (long long)footprint(ast));
+    st.add("mem.symtab.bytes", (long long)footprint(sem.symbols()));
+    st.add("mem.symorder.bytes", (long long)footprint(sem.symbolOrder()));
+    st.add("mem.tac.bytes", (long long)footprint(tac));
+    if (!pm.empty()) {
+        st.add("mem.opt.bytes", (long long)footprint(opt));
+        st.add("mem.opt.peak.bytes", (long long)pm.peakFootprint());
+    }
+    st.add("mem.peak-rss.bytes", (long long)peakRSSBytes());
+}
+
+#ifdef MINI_COUNT_ALLOCS
+// Allocations so far by phase and by category, plus allocations per token
+// while lexing (0.00 once the lexer stops allocating per token).
+static void addAllocStats(Stats& st, size_t tokenCount) {
+    const AllocCounters& c = g_allocCounters;
+    st.add("alloc.count", (long long)c.total.count);
+    st.add("alloc.bytes", (long long)c.total.bytes);
+    for (int k = 0; k < (int)AllocPhase::COUNT; k++) {
+        string key = string("alloc.") + allocPhaseName((AllocPhase)k);
+        st.add(key + ".count", (long long)c.phase[k].count);
+        st.add(key + ".bytes", (long long)c.phase[k].bytes);
+    }
+    for (int k = 0; k < (int)AllocCategory::COUNT; k++) {
+        string key = string("alloc.of.") + allocCategoryName((AllocCategory)k);
+        st.add(key + ".count", (long long)c.category[k].count);
+        st.add(key + ".bytes", (long long)c.category[k].bytes);
+    }
+    double perToken = tokenCount ? (double)c.phase[(int)AllocPhase::Lex].count / (double)tokenCount : 0.0;
+    st.add("alloc.lex.per-token", perToken, 2);
+}
+#endif
+
+static void printPassTimings(const PassManager& pm) {
+    double total = 0;
+    cerr << "PASS TIMINGS:\n";
+    for (const auto& t : pm.report()) {
+        cerr << left << setw(16) << t.name << right << setw(10) << fixed << setprecision(3) << t.ms << " ms"
+             << setw(10) << t.before << " -> " << left << setw(10) << t.after
+             << "(" << showpos << (long long)t.after - (long long)t.before << noshowpos << ")\n";
+        total += t.ms;
+    }
+    cerr << left << setw(16) << "total" << right << setw(10) << fixed << setprecision(3) << total << " ms\n";
+}
+
+// =========================================================
+// HARDWARE PERFORMANCE COUNTERS (--perf-counters)
+// =========================================================
+// Cycles, instructions, branch misses and L1D / LLC read misses of this
+// process (user space only) per phase, via Linux perf_event_open. Events the
+// kernel refuses (no PMU in a container or VM, perf_event_paranoid too high)
+// are reported as unavailable and the rest still count. Counts of a
+// multiplexed event are scaled by its enabled / running time.
+class PerfCounters {
+public:
+    static const int EVENTS = 5;
+
+    struct Reading {
+        uint64_t value[EVENTS] = {}, enabled[EVENTS] = {}, running[EVENTS] = {};
+        chrono::steady_clock::time_point at;
+    };
+
+    struct Phase {
+        string name;
+        double ms = 0;
+        double value[EVENTS] = {};
+        bool valid[EVENTS] = {};
+    };
+
+    static const char* eventName(int k) {
+        static const char* names[EVENTS] = {"cycles", "instructions", "branch-misses", "l1d-misses", "llc-misses"};
+        return names[k];
+    }
+
+private:
+    int fds[EVENTS];
+    string whyUnavailable;
+    vector<Phase> phases;
+
+public:
+    PerfCounters() {
+        for (int& fd : fds) fd = -1;
+#ifdef MINI_LINUX
+        const uint64_t cacheReadMiss = ((uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       ((uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        const pair<uint32_t, uint64_t> events[EVENTS] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cacheReadMiss},
+            {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cacheReadMiss},
+        };
+        for (int k = 0; k < EVENTS; k++) {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = events[k].first;
+            attr.config = events[k].second;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            fds[k] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+            if (fds[k] < 0 && whyUnavailable.empty())
+                whyUnavailable = string(eventName(k)) + ": perf_event_open: " + strerror(errno);
+        }
+#else
+        whyUnavailable = "perf_event_open is Linux-only";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef MINI_LINUX
+        for (int fd : fds)
+            if (fd >= 0) close(fd);
+#endif
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available(int k) const { return fds[k] >= 0; }
+    bool anyAvailable() const {
+        for (int k = 0; k < EVENTS; k++)
+            if (available(k)) return true;
+        return false;
+    }
+    // First refusal, empty when every event opened.
+    const string& reason() const { return whyUnavailable; }
+
+    Reading read() const {
+        Reading r;
+#ifdef MINI_LINUX
+        for (int k = 0; k < EVENTS; k++) {
+            uint64_t buf[3];
+            if (fds[k] >= 0 && ::read(fds[k], buf, sizeof buf) == (ssize_t)sizeof buf) {
+                r.value[k] = buf[0];
+                r.enabled[k] = buf[1];
+                r.running[k] = buf[2];
+            }
+        }
+#endif
+        r.at = chrono::steady_clock::now();
+        return r;
+    }
+
+    void record(const string& name, const Reading& a, const Reading& b) {
+        Phase ph;
+        ph.name = name;
+        ph.ms = chrono::duration<double, milli>(b.at - a.at).count();
+        for (int k = 0; k < EVENTS; k++) {
+            uint64_t running = b.running[k] - a.running[k];
+            if (!available(k) || running == 0) continue;   // never scheduled during the phase
+            double scale = (double)(b.enabled[k] - a.enabled[k]) / (double)running;
+            ph.value[k] = (double)(b.value[k] - a.value[k]) * scale;
+            ph.valid[k] = true;
+        }
+        phases.push_back(ph);
+    }
+
+    const vector<Phase>& report() const { return phases; }
+};
+
+// Records one phase on destruction; a null PerfCounters makes it a no-op.
+class PerfScope {
+    PerfCounters* pc;
+    const char* name;
+    PerfCounters::Reading start;
+
+public:
+    PerfScope(PerfCounters* counters, const char* phase) : pc(counters), name(phase) {
+        if (pc) start = pc->read();
+    }
+    ~PerfScope() {
+        if (pc) pc->record(name, start, pc->read());
+    }
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+};
 
-        // Phase 2: Parser -> AST
-        Parser parser(tokens);
-        Program ast = parser.parse();
+static void printPerfCounters(const PerfCounters& pc) {
+    if (!pc.anyAvailable()) {
+        cerr << "PERF COUNTERS: unavailable (" << pc.reason() << ")\n";
+        return;
+    }
+    cerr << "PERF COUNTERS:\n";
+    cerr << left << setw(10) << "phase" << right << setw(10) << "ms";
+    for (int k = 0; k < PerfCounters::EVENTS; k++) cerr << setw(15) << PerfCounters::eventName(k);
+    cerr << setw(7) << "IPC" << "\n";
+    for (const auto& ph : pc.report()) {
+        cerr << left << setw(10) << ph.name << right << setw(10) << fixed << setprecision(3) << ph.ms;
+        for (int k = 0; k < PerfCounters::EVENTS; k++) {
+            if (ph.valid[k]) cerr << setw(15) << fixed << setprecision(0) << ph.value[k];
+            else cerr << setw(15) << "n/a";
+        }
+        if (ph.valid[0] && ph.valid[1] && ph.value[0] > 0)
+            cerr << setw(7) << fixed << setprecision(2) << ph.value[1] / ph.value[0];
+        else cerr << setw(7) << "n/a";
+        cerr << "\n";
+    }
+    if (!pc.reason().empty()) cerr << "(n/a: " << pc.reason() << ")\n";
+}
+
+static void addPerfStats(Stats& st, const PerfCounters& pc) {
+    for (const auto& ph : pc.report()) {
+        for (int k = 0; k < PerfCounters::EVENTS; k++)
+            if (ph.valid[k]) st.add("perf." + ph.name + "." + PerfCounters::eventName(k), (long long)ph.value[k]);
+    }
+}
+
+// =========================================================
+// DRIVER
+// =========================================================
+struct Options {
+    int optLevel = 2;
+    bool stats = false;
+    bool statsMemory = false;   // mem.* rows; --stats=time leaves out their TAC walks
+    bool dumpSSA = false;
+    bool dumpCallGraph = false;
+    bool timePasses = false;
+    bool perfCounters = false;
+    bool run = false;
+    bool session = false;
+    vector<string> enablePasses, disablePasses;
+};
+
+// Value of a --name=N limit option: a non-negative number.
+static double limitValue(const string& arg) {
+    string v = arg.substr(arg.find('=') + 1);
+    char* end = nullptr;
+    errno = 0;
+    double x = strtod(v.c_str(), &end);
+    if (v.empty() || *end != '\0' || errno != 0 || !(x >= 0) || x > 1e15)
+        throw runtime_error("Invalid value in option '" + arg + "' (expected a non-negative number)");
+    return x;
+}
+
+static Options parseOptions(int argc, char** argv) {
+    Options o;
+    for (int k = 1; k < argc; k++) {
+        string arg = argv[k];
+        if (arg == "-O0" || arg == "-O1" || arg == "-O2") o.optLevel = arg[2] - '0';
+        else if (arg == "--stats") o.stats = o.statsMemory = true;
+        else if (arg == "--stats=time") o.stats = true;
+        else if (arg == "--dump-ssa") o.dumpSSA = true;
+        else if (arg == "--dump-callgraph") o.dumpCallGraph = true;
+        else if (arg == "--time-passes") o.timePasses = true;
+        else if (arg == "--perf-counters") o.perfCounters = true;
+        else if (arg.rfind("--max-tokens=", 0) == 0) g_limits.maxTokens = (size_t)limitValue(arg);
+        else if (arg.rfind("--max-nodes=", 0) == 0) g_limits.maxNodes = (size_t)limitValue(arg);
+        else if (arg.rfind("--max-depth=", 0) == 0) g_limits.maxDepth = (size_t)limitValue(arg);
+        else if (arg.rfind("--max-temps=", 0) == 0) g_limits.maxTemps = (size_t)limitValue(arg);
+        else if (arg.rfind("--time-budget-ms=", 0) == 0) g_limits.timeBudgetMs = limitValue(arg);
+        else if (arg == "--run") o.run = true;
+        else if (arg == "--session") o.session = true;
+        else if (arg.rfind("--enable-pass=", 0) == 0 || arg.rfind("--disable-pass=", 0) == 0) {
+            bool enable = arg[2] == 'e';
+            string name = arg.substr(arg.find('=') + 1);
+            if (!isKnownPass(name)) throw runtime_error("Unknown pass '" + name + "' in option '" + arg + "'");
+            (enable ? o.enablePasses : o.disablePasses).push_back(name);
+        }
+        else throw runtime_error("Unknown option '" + arg + "'");
+    }
+    return o;
+}
 
-        // Phase 3: Semantic analysis -> Symbol table checks
-        SemanticAnalyzer sem;
+// Phases 3 and later plus the reports at the end, shared by main and session mode.
+static void runBackEnd(const Options& opts, Stats& stats, PerfCounters* perf, const vector<Token>& tokens, const Program& ast) {
+    // Phase 3: Semantic analysis -> Symbol table checks
+    SemanticAnalyzer sem;
+    {
+        AllocPhaseScope phase(AllocPhase::Semantic);
+        PerfScope counters(perf, "semantic");
+        PhaseTimer timer(stats, "semantic");
         sem.analyze(ast);
-        printSymbolTable(sem);
+    }
+    printSymbolTable(sem);
+    for (const auto& w : sem.warnings()) cerr << w << "\n";
+
+    // Phase 4: TAC generation
+    TACGenerator gen;
+    TACProgram tac;
+    {
+        AllocPhaseScope phase(AllocPhase::TAC);
+        PerfScope counters(perf, "tac");
+        PhaseTimer timer(stats, "tac");
+        tac = gen.generate(ast);
+    }
+    printTAC(tac);
+    if (opts.dumpCallGraph) CallGraph(tac).print(cout, tac);
+
+    // Phase 5: Optimization (-O0 with no enabled pass leaves the TAC as is)
+    PassManager pm;
+    buildPipeline(pm, opts.optLevel, opts.enablePasses, opts.disablePasses);
+    pm.setDumpSSA(opts.dumpSSA);
+    pm.setTrackFootprint(opts.statsMemory);
+    TACProgram opt;
+    {
+        AllocPhaseScope phase(AllocPhase::Opt);
+        PerfScope counters(perf, "opt");
+        PhaseTimer timer(stats, "opt");
+        opt = tac;
+        if (!pm.empty() || opts.dumpSSA) pm.run(opt);
+        if (pm.has("inline")) removeUncalledFunctions(opt);
+    }
+    if (opts.dumpSSA) printTAC(pm.ssa(), "SSA FORM:");
+    if (!pm.empty()) printTAC(opt, "OPTIMIZED CODE (TAC):");
+
+    addOptimizationStats(stats, tac.size(), opt.size(), pm);
+
+    // Phase 6 (optional): execute the final code on the VM
+    if (opts.run) {
+        AllocPhaseScope phase(AllocPhase::VM);
+        VM vm(pm.empty() ? tac : opt, sem.symbols());
+        cout << "PROGRAM OUTPUT:\n";
+        auto t0 = chrono::steady_clock::now();
+        uint64_t steps;
+        {
+            PerfScope counters(perf, "vm");
+            steps = vm.run(cout);
+        }
+        auto t1 = chrono::steady_clock::now();
+        cout << "\n";
+        stats.add("vm.instructions", (long long)steps);
+        stats.add("vm.ms", chrono::duration<double, milli>(t1 - t0).count(), 3);
+        stats.add("vm.simd", string(vecLevelName(vecKernels().level)));
+    }
+
+    if (opts.statsMemory) addFootprintStats(stats, tokens, ast, sem, tac, opt, pm);
+#ifdef MINI_COUNT_ALLOCS
+    addAllocStats(stats, tokens.size());
+#endif
+    if (perf) addPerfStats(stats, *perf);
+    if (opts.stats) stats.print(cerr);
+    if (opts.timePasses) printPassTimings(pm);
+    if (perf) printPerfCounters(*perf);
+}
+
+// One whole compile of src: prints what the options ask for, throws the first error.
+// Shared by main and the WebAssembly entry point (tools/wasm.cpp).
+static void compileProgram(const Options& opts, const string& src) {
+    startTimeBudget();
+
+    Stats stats;
+    unique_ptr<PerfCounters> perf;
+    if (opts.perfCounters) perf = make_unique<PerfCounters>();
+
+    // Phase 1: Lexer
+    Lexer lexer(src);
+    vector<Token> tokens;
+    {
+        AllocPhaseScope phase(AllocPhase::Lex);
+        PerfScope counters(perf.get(), "lex");
+        PhaseTimer timer(stats, "lex");
+        tokens = lexer.tokenize();
+    }
+    printTokens(tokens);
 
-        // Phase 4: TAC generation
-        TACGenerator gen;
-        auto tac = gen.generate(ast);
-        printTAC(tac);
+    // Phase 2: Parser -> AST
+    Parser parser(tokens);
+    Program ast;
+    {
+        AllocPhaseScope phase(AllocPhase::Parse);
+        PerfScope counters(perf.get(), "parse");
+        PhaseTimer timer(stats, "parse");
+        ast = parser.parse();
+    }
+
+    runBackEnd(opts, stats, perf.get(), tokens, ast);
+}
+
+// =========================================================
+// SESSION MODE (--session: incremental recompiles for the IDE)
+// =========================================================
+// A long-lived process holding one document, driven over stdin:
+//   EDIT <start> <end> <n>\n<n bytes>   replace bytes [start, end) of the document
+//   COMPILE\n                            compile it
+// Every COMPILE is answered on stdout with
+//   RESULT <exit code> <stdout bytes> <stderr bytes>\n<stdout><stderr>
+// holding what a one-shot run with the same options would print.
+// Work kept between compiles:
+//   - an edit relexes only the lines it touches; the tokens after them are
+//     kept, their lines shifted;
+//   - a top-level item (function, declaration or statement) is kept while
+//     none of its tokens, nor the token after it the parser peeked at, was
+//     relexed; parsing goes item by item and splices a kept item in wherever
+//     one starts at the current position.
+// Semantic analysis, TAC and the passes still see the whole program.
+static void shiftLines(Expr* e, int delta) {
+    if (!e) return;
+    if (auto n = dynamic_cast<NumExpr*>(e)) n->tok.line += delta;
+    else if (auto v = dynamic_cast<VarExpr*>(e)) v->tok.line += delta;
+    else if (auto x = dynamic_cast<IndexExpr*>(e)) {
+        x->name.line += delta;
+        shiftLines(x->index.get(), delta);
+    } else if (auto c = dynamic_cast<CallExpr*>(e)) {
+        c->name.line += delta;
+        for (auto& a : c->args) shiftLines(a.get(), delta);
+    } else if (auto u = dynamic_cast<UnaryExpr*>(e)) {
+        u->op.line += delta;
+        shiftLines(u->rhs.get(), delta);
+    } else if (auto b = dynamic_cast<BinaryExpr*>(e)) {
+        b->op.line += delta;
+        shiftLines(b->lhs.get(), delta);
+        shiftLines(b->rhs.get(), delta);
+    }
+}
+
+static void shiftLines(Stmt* s, int delta) {
+    if (!s) return;
+    if (auto d = dynamic_cast<DeclStmt*>(s)) {
+        d->name.line += delta;
+        d->size.line += delta;
+    } else if (auto a = dynamic_cast<AssignStmt*>(s)) {
+        a->name.line += delta;
+        shiftLines(a->index.get(), delta);
+        shiftLines(a->rhs.get(), delta);
+    } else if (auto p = dynamic_cast<PrintStmt*>(s)) {
+        p->kw.line += delta;
+        shiftLines(p->expr.get(), delta);
+    } else if (auto r = dynamic_cast<ReturnStmt*>(s)) {
+        r->kw.line += delta;
+        shiftLines(r->value.get(), delta);
+    } else if (auto c = dynamic_cast<CallStmt*>(s)) {
+        shiftLines(c->call.get(), delta);
+    } else if (auto f = dynamic_cast<FuncDecl*>(s)) {
+        f->name.line += delta;
+        for (auto& t : f->params) t.line += delta;
+        for (auto& x : f->body) shiftLines(x.get(), delta);
+    } else if (auto b = dynamic_cast<BlockStmt*>(s)) {
+        for (auto& x : b->stmts) shiftLines(x.get(), delta);
+    } else if (auto i = dynamic_cast<IfStmt*>(s)) {
+        i->kw.line += delta;
+        shiftLines(i->cond.get(), delta);
+        shiftLines(i->thenS.get(), delta);
+        shiftLines(i->elseS.get(), delta);
+    } else if (auto w = dynamic_cast<WhileStmt*>(s)) {
+        w->kw.line += delta;
+        shiftLines(w->cond.get(), delta);
+        shiftLines(w->body.get(), delta);
+    }
+}
+
+class SessionDocument {
+    struct Item {
+        unique_ptr<Stmt> stmt;
+        size_t begin, end;   // tokens [begin, end); the parser also peeked at tokens[end]
+        size_t nodes;        // for --max-nodes when the item is kept
+        int lineShift;       // line delta not yet applied to the AST
+    };
+
+    string src;
+    vector<Token> tokens{{TokenType::END, "EOF", 1, 1}};
+    vector<size_t> offsets{0};   // byte offset of every token (END: the document size)
+    bool lexed = true;           // false after an edit that failed to lex: the next compile relexes it all
+    vector<Item> items;          // in token order
+
+    // Since the last compile, for --stats.
+    double lexMs = 0;
+    size_t relexedTokens = 0;
+
+    // Offsets of tokens lexed from `text`, which sits at `base` and starts line firstLine.
+    static vector<size_t> offsetsOf(const vector<Token>& toks, const string& text, size_t base, int firstLine) {
+        vector<size_t> lineStart{0};
+        for (size_t k = 0; k < text.size(); k++)
+            if (text[k] == '\n') lineStart.push_back(k + 1);
+        vector<size_t> offs;
+        offs.reserve(toks.size());
+        for (const auto& t : toks) offs.push_back(base + lineStart[(size_t)(t.line - firstLine)] + (size_t)t.col - 1);
+        return offs;
+    }
+
+    void relexAll() {
+        tokens = Lexer(src).tokenize();
+        offsets = offsetsOf(tokens, src, 0, 1);
+        relexedTokens += tokens.size();
+        items.clear();
+        lexed = true;
+    }
+
+    void relex(size_t start, size_t end, const string& text) {
+        // Lexing is line-local (no token or comment spans a newline), so whole lines are enough.
+        size_t nl = start == 0 ? string::npos : src.rfind('\n', start - 1);
+        size_t from = nl == string::npos ? 0 : nl + 1;
+        size_t stop = src.find('\n', end);
+        stop = stop == string::npos ? src.size() : stop + 1;
+        bool toEnd = stop == src.size();   // END moves too
+        int line = 1 + (int)count(src.begin(), src.begin() + (long)from, '\n');
+        int lineDelta = (int)count(text.begin(), text.end(), '\n') - (int)count(src.begin() + (long)start, src.begin() + (long)end, '\n');
+        size_t oa = (size_t)(lower_bound(offsets.begin(), offsets.end(), from) - offsets.begin());
+        size_t ob = toEnd ? tokens.size() : (size_t)(lower_bound(offsets.begin(), offsets.end(), stop) - offsets.begin());
+
+        src.replace(start, end - start, text);
+        long byteDelta = (long)text.size() - (long)(end - start);
+        string piece = src.substr(from, (size_t)((long)stop + byteDelta) - from);
+        vector<Token> fresh;
+        try {
+            fresh = Lexer(piece, line).tokenize();
+        } catch (const runtime_error&) {
+            lexed = false;   // reported by the next compile
+            items.clear();
+            return;
+        }
+        vector<size_t> freshOffsets = offsetsOf(fresh, piece, from, line);
+        if (!toEnd) {   // the piece's END is not the document's
+            fresh.pop_back();
+            freshOffsets.pop_back();
+        }
+        relexedTokens += fresh.size();
+
+        for (size_t k = ob; k < tokens.size(); k++) {
+            tokens[k].line += lineDelta;
+            offsets[k] = (size_t)((long)offsets[k] + byteDelta);
+        }
+        tokens.erase(tokens.begin() + (long)oa, tokens.begin() + (long)ob);
+        tokens.insert(tokens.begin() + (long)oa, make_move_iterator(fresh.begin()), make_move_iterator(fresh.end()));
+        offsets.erase(offsets.begin() + (long)oa, offsets.begin() + (long)ob);
+        offsets.insert(offsets.begin() + (long)oa, freshOffsets.begin(), freshOffsets.end());
+
+        long tokenDelta = (long)fresh.size() - (long)(ob - oa);
+        vector<Item> kept;
+        for (auto& it : items) {
+            if (it.end < oa) kept.push_back(std::move(it));
+            else if (it.begin >= ob) {
+                it.begin = (size_t)((long)it.begin + tokenDelta);
+                it.end = (size_t)((long)it.end + tokenDelta);
+                it.lineShift += lineDelta;
+                kept.push_back(std::move(it));
+            }
+        }
+        items = std::move(kept);
+    }
+
+    void parse(Stats& stats) {
+        Parser ps(tokens);
+        vector<Item> next;
+        size_t k = 0, kept = 0;
+        try {
+            while (!ps.atEnd()) {
+                size_t pos = ps.position();
+                while (k < items.size() && items[k].begin < pos) k++;
+                if (k < items.size() && items[k].begin == pos) {
+                    Item& it = items[k++];
+                    ps.countReused(it.nodes);
+                    if (it.lineShift) shiftLines(it.stmt.get(), it.lineShift);
+                    it.lineShift = 0;
+                    ps.seek(it.end);
+                    next.push_back(std::move(it));
+                    kept++;
+                    continue;
+                }
+                size_t nodes = ps.nodeCount();
+                auto stmt = ps.parseTopLevel();
+                next.push_back({std::move(stmt), pos, ps.position(), ps.nodeCount() - nodes, 0});
+            }
+        } catch (...) {
+            // Items not reached are still valid for the next attempt.
+            for (; k < items.size(); k++) next.push_back(std::move(items[k]));
+            items = std::move(next);
+            throw;
+        }
+        items = std::move(next);
+        stats.add("session.items.kept", (long long)kept);
+        stats.add("session.items.parsed", (long long)(items.size() - kept));
+    }
+
+    // The AST borrows the items' statements while the back end runs.
+    class Lend {
+        vector<Item>& items;
+        Program& ast;
+
+    public:
+        Lend(vector<Item>& i, Program& a) : items(i), ast(a) {
+            for (auto& it : items) ast.stmts.push_back(std::move(it.stmt));
+        }
+        ~Lend() {
+            for (size_t k = 0; k < items.size(); k++) items[k].stmt = std::move(ast.stmts[k]);
+        }
+        Lend(const Lend&) = delete;
+        Lend& operator=(const Lend&) = delete;
+    };
+
+public:
+    void edit(size_t start, size_t end, const string& text) {
+        if (start > end || end > src.size())
+            throw runtime_error("Session error: edit range " + to_string(start) + ".." + to_string(end) +
+                                " is outside the document (" + to_string(src.size()) + " bytes)");
+        if (!lexed) {
+            src.replace(start, end - start, text);
+            return;
+        }
+        AllocPhaseScope phase(AllocPhase::Lex);
+        auto t0 = chrono::steady_clock::now();
+        relex(start, end, text);
+        lexMs += chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    }
+
+    // Prints what main would for the current document; throws its errors.
+    void compile(const Options& opts) {
+        Stats stats;
+        unique_ptr<PerfCounters> perf;
+        if (opts.perfCounters) perf = make_unique<PerfCounters>();
+
+        if (!lexed) {
+            AllocPhaseScope phase(AllocPhase::Lex);
+            PerfScope counters(perf.get(), "lex");
+            PhaseTimer timer(stats, "lex");
+            relexAll();
+        } else stats.add("phase.lex.ms", lexMs, 3);
+        stats.add("session.tokens.relexed", (long long)relexedTokens);
+        lexMs = 0;
+        relexedTokens = 0;
+        if (g_limits.maxTokens && tokens.size() - 1 > g_limits.maxTokens) {
+            const Token& t = tokens[g_limits.maxTokens];
+            limitError("more than " + to_string(g_limits.maxTokens) + " tokens (--max-tokens).", t.line, t.col);
+        }
+        printTokens(tokens);
+
+        {
+            AllocPhaseScope phase(AllocPhase::Parse);
+            PerfScope counters(perf.get(), "parse");
+            PhaseTimer timer(stats, "parse");
+            parse(stats);
+        }
+        Program ast;
+        Lend lend(items, ast);
+        runBackEnd(opts, stats, perf.get(), tokens, ast);
+    }
+};
+
+// Points a stream at another buffer for the lifetime of the object.
+class StreamRedirect {
+    ostream& os;
+    streambuf* saved;
+
+public:
+    StreamRedirect(ostream& from, ostream& to) : os(from), saved(from.rdbuf(to.rdbuf())) {}
+    ~StreamRedirect() { os.rdbuf(saved); }
+    StreamRedirect(const StreamRedirect&) = delete;
+    StreamRedirect& operator=(const StreamRedirect&) = delete;
+};
+
+static int runSession(const Options& opts) {
+    SessionDocument doc;
+    string line;
+    while (getline(cin, line)) {
+        istringstream cmd(line);
+        string op;
+        cmd >> op;
+        if (op == "EDIT") {
+            size_t start = 0, end = 0, n = 0;
+            if (!(cmd >> start >> end >> n)) throw runtime_error("Session error: malformed command '" + line + "'");
+            string text(n, '\0');
+            if (!cin.read(&text[0], (streamsize)n)) throw runtime_error("Session error: edit text ends early");
+            startTimeBudget();
+            doc.edit(start, end, text);
+        } else if (op == "COMPILE") {
+            ostringstream out, err;
+            int exitCode = 0;
+            {
+                StreamRedirect toOut(cout, out), toErr(cerr, err);
+                startTimeBudget();
+                try {
+                    doc.compile(opts);
+                } catch (const exception& ex) {
+                    cerr << ex.what() << "\n";
+                    exitCode = 1;
+                }
+            }
+            string o = out.str(), e = err.str();
+            cout << "RESULT " << exitCode << " " << o.size() << " " << e.size() << "\n" << o << e << flush;
+        } else throw runtime_error("Session error: unknown command '" + line + "'");
+    }
+    return 0;
+}
+
+// Tools that reuse the phases (tools/bench.cpp) include this file with
+// MINI_COMPILER_NO_MAIN defined and bring their own main.
+#ifndef MINI_COMPILER_NO_MAIN
+int main(int argc, char** argv) {
+    try {
+        Options opts = parseOptions(argc, argv);
+        if (opts.session) return runSession(opts);
 
+        // Read entire source program from stdin
+        ostringstream oss;
+        oss << cin.rdbuf();
+        compileProgram(opts, oss.str());
         return 0;
     } catch (const exception& ex) {
         cerr << ex.what() << "\n";
         return 1;
     }
 }
+#endif
@@ -0,0 +1,127 @@
+// metrics.js - minimal in-process metrics in the Prometheus text format
+// Counters, gauges and histograms with optional labels, rendered by
+// Registry.render() for a /metrics endpoint. No external dependencies.
+
+function labelKey(labels) {
+  const names = Object.keys(labels).sort();
+  return names.map((n) => `${n}="${String(labels[n]).replace(/\\/g, "\\\\").replace(/"/g, '\\"').replace(/\n/g, "\\n")}"`).join(",");
+}
+
+function formatValue(v) {
+  if (v === Infinity) return "+Inf";
+  if (v === -Infinity) return "-Inf";
+  return String(v);
+}
+
+class Counter {
+  constructor(name, help) {
+    this.name = name;
+    this.help = help;
+    this.values = new Map(); // label key -> value
+  }
+
+  inc(labels = {}, by = 1) {
+    const key = labelKey(labels);
+    this.values.set(key, (this.values.get(key) || 0) + by);
+  }
+
+  get(labels = {}) {
+    return this.values.get(labelKey(labels)) || 0;
+  }
+
+  render() {
+    const lines = [`# HELP ${this.name} ${this.help}`, `# TYPE ${this.name} counter`];
+    for (const [key, v] of this.values) lines.push(`${this.name}${key ? `{${key}}` : ""} ${formatValue(v)}`);
+    return lines;
+  }
+}
+
+// Either set() directly or computed at scrape time by `collect`.
+class Gauge {
+  constructor(name, help, collect = null) {
+    this.name = name;
+    this.help = help;
+    this.collect = collect;
+    this.value = 0;
+  }
+
+  set(v) {
+    this.value = v;
+  }
+
+  render() {
+    const v = this.collect ? this.collect() : this.value;
+    return [`# HELP ${this.name} ${this.help}`, `# TYPE ${this.name} gauge`, `${this.name} ${formatValue(v)}`];
+  }
+}
+
+class Histogram {
+  constructor(name, help, buckets) {
+    this.name = name;
+    this.help = help;
+    this.buckets = [...buckets].sort((a, b) => a - b);
+    this.series = new Map(); // label key -> { counts, sum, count }
+  }
+
+  observe(value, labels = {}) {
+    const key = labelKey(labels);
+    let s = this.series.get(key);
+    if (!s) {
+      s = { counts: new Array(this.buckets.length).fill(0), sum: 0, count: 0 };
+      this.series.set(key, s);
+    }
+    for (let k = 0; k < this.buckets.length; k++) {
+      if (value <= this.buckets[k]) {
+        s.counts[k]++;
+        break;
+      }
+    }
+    s.sum += value;
+    s.count++;
+  }
+
+  render() {
+    const lines = [`# HELP ${this.name} ${this.help}`, `# TYPE ${this.name} histogram`];
+    for (const [key, s] of this.series) {
+      const sep = key ? "," : "";
+      let cumulative = 0;
+      for (let k = 0; k < this.buckets.length; k++) {
+        cumulative += s.counts[k];
+        lines.push(`${this.name}_bucket{${key}${sep}le="${formatValue(this.buckets[k])}"} ${cumulative}`);
+      }
+      lines.push(`${this.name}_bucket{${key}${sep}le="+Inf"} ${s.count}`);
+      lines.push(`${this.name}_sum${key ? `{${key}}` : ""} ${formatValue(s.sum)}`);
+      lines.push(`${this.name}_count${key ? `{${key}}` : ""} ${s.count}`);
+    }
+    return lines;
+  }
+}
+
+class Registry {
+  constructor() {
+    this.metrics = [];
+  }
+
+  counter(name, help) {
+    return this.add(new Counter(name, help));
+  }
+
+  gauge(name, help, collect) {
+    return this.add(new Gauge(name, help, collect));
+  }
+
+  histogram(name, help, buckets) {
+    return this.add(new Histogram(name, help, buckets));
+  }
+
+  add(metric) {
+    this.metrics.push(metric);
+    return metric;
+  }
+
+  render() {
+    return this.metrics.flatMap((m) => m.render()).join("\n") + "\n";
+  }
+}
+
+module.exports = { Registry };
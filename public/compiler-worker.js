@@ -0,0 +1,68 @@
+// compiler-worker.js - the WebAssembly compiler (tools/wasm.cpp) off the UI thread
+// Loads wasm/mini-compiler.js (npm run build:wasm) and posts {type: "ready"},
+// or {type: "unavailable", reason} when WebAssembly or the build is missing so
+// the page keeps compiling on the server. Then answers
+//   {id, code, args}  with  {id, ok, exitCode, stdout, stderr, tokens, symbolTable, tac}
+// in the compact shape of /api/compile (stdout only when it could not be split).
+"use strict";
+
+let compiler = null;
+
+// Same headers as splitCompilerOutput in server.js.
+function splitOutput(out) {
+  const a = out.indexOf("TOKENS:");
+  const b = out.indexOf("SYMBOL TABLE:");
+  const c = out.indexOf("INTERMEDIATE CODE (TAC):");
+  if (a === -1 || b === -1 || c === -1) return { stdout: out };
+  return {
+    tokens: out.slice(a, b).trimEnd() + "\n",
+    symbolTable: out.slice(b, c).trimEnd() + "\n",
+    tac: out.slice(c).trimEnd() + "\n",
+  };
+}
+
+function wrap(Module) {
+  // Strings go through malloc rather than ccall's stack copies, which a big program would overflow.
+  const heapString = (s) => {
+    const size = Module.lengthBytesUTF8(s) + 1;
+    const ptr = Module._malloc(size);
+    Module.stringToUTF8(s, ptr, size);
+    return ptr;
+  };
+  return (code, args) => {
+    const src = heapString(code);
+    const argv = heapString(args);
+    try {
+      const exitCode = Module._mini_compile(src, argv);
+      return { exitCode, stdout: Module.UTF8ToString(Module._mini_stdout()), stderr: Module.UTF8ToString(Module._mini_stderr()) };
+    } finally {
+      Module._free(src);
+      Module._free(argv);
+    }
+  };
+}
+
+self.onmessage = (ev) => {
+  const { id, code, args } = ev.data;
+  let result;
+  try {
+    result = compiler(code, args);
+  } catch (err) {
+    result = { exitCode: -1, stdout: "", stderr: `WebAssembly compiler failed: ${err.message || err}\n` };
+  }
+  self.postMessage({ id, ok: result.exitCode === 0, exitCode: result.exitCode, stderr: result.stderr, ...splitOutput(result.stdout) });
+};
+
+try {
+  if (typeof WebAssembly !== "object") throw new Error("WebAssembly is not supported");
+  importScripts("wasm/mini-compiler.js");
+  createMiniCompiler({ locateFile: (file) => `wasm/${file}` }).then(
+    (Module) => {
+      compiler = wrap(Module);
+      self.postMessage({ type: "ready" });
+    },
+    (err) => self.postMessage({ type: "unavailable", reason: String(err) }),
+  );
+} catch (err) {
+  self.postMessage({ type: "unavailable", reason: String(err) });
+}
@@ -4,16 +4,66 @@ const loadSampleBtn = document.getElementById("loadSampleBtn");
 const statusEl = document.getElementById("status");
 const exitInfoEl = document.getElementById("exitInfo");
 
+// Output panels render only the rows in view plus OVERSCAN above and below:
+// a spacer gives the scrollbar the full height and a small <pre> follows the
+// scroll position. Rows do not wrap, so they all have the same height, and a
+// 100k-line output costs about as much to show as one screenful.
+const OVERSCAN = 30;
+
+class VirtualText {
+  constructor(el) {
+    this.el = el;
+    this.lines = [];
+    this.rowHeight = 0;
+    this.frame = 0;
+    this.spacer = document.createElement("div");
+    this.view = document.createElement("pre");
+    this.view.className = "mono absolute top-0 left-0 px-3 m-0 whitespace-pre";
+    el.append(this.spacer, this.view);
+    el.addEventListener("scroll", () => this.schedule());
+    // also fires when a hidden tab is shown
+    new ResizeObserver(() => this.schedule()).observe(el);
+  }
+
+  setText(text) {
+    this.lines = text ? text.replace(/\n$/, "").split("\n") : [];
+    this.schedule();
+  }
+
+  schedule() {
+    if (this.frame) return;
+    this.frame = requestAnimationFrame(() => {
+      this.frame = 0;
+      this.render();
+    });
+  }
+
+  render() {
+    if (!this.el.clientHeight) return; // hidden tab
+    if (!this.rowHeight) {
+      this.view.textContent = "X";
+      this.rowHeight = this.view.getBoundingClientRect().height || 20;
+    }
+    const h = this.rowHeight;
+    const top = this.el.scrollTop;
+    const first = Math.max(0, Math.floor(top / h) - OVERSCAN);
+    const last = Math.min(this.lines.length, Math.ceil((top + this.el.clientHeight) / h) + OVERSCAN);
+    this.spacer.style.height = `${this.lines.length * h}px`;
+    this.view.style.transform = `translateY(${first * h}px)`;
+    this.view.textContent = this.lines.slice(first, last).join("\n");
+  }
+}
+
 const panels = {
-  tokens: document.getElementById("panel-tokens"),
-  symbols: document.getElementById("panel-symbols"),
-  tac: document.getElementById("panel-tac"),
-  raw: document.getElementById("panel-raw"),
+  tokens: new VirtualText(document.getElementById("panel-tokens")),
+  symbols: new VirtualText(document.getElementById("panel-symbols")),
+  tac: new VirtualText(document.getElementById("panel-tac")),
+  raw: new VirtualText(document.getElementById("panel-raw")),
 };
 
 function setActiveTab(tabName) {
   document.querySelectorAll(".panel").forEach((p) => p.classList.add("hidden"));
-  panels[tabName].classList.remove("hidden");
+  panels[tabName].el.classList.remove("hidden");
 
   document.querySelectorAll(".tab").forEach((b) => {
     const active = b.dataset.tab === tabName;
@@ -38,49 +88,244 @@ print b;
 `;
 });
 
-async function runCompiler() {
+// Fills the panels from a compact result (stdout only when it could not be split).
+function showResult(data) {
+  panels.tokens.setText(data.tokens || "");
+  panels.symbols.setText(data.symbolTable || "");
+  panels.tac.setText(data.tac || "");
+  const stdout = data.stdout || [data.tokens, data.symbolTable, data.tac].filter(Boolean).join("\n");
+  panels.raw.setText(stdout + (data.stderr ? "\n" + data.stderr : ""));
+  exitInfoEl.textContent = `exit=${data.exitCode}`;
+}
+
+// Without a live session, typing compiles over HTTP once the editor has been
+// idle for AUTO_COMPILE_MS. Only the newest compile matters: starting one (or
+// typing again) aborts the request in flight, and the server then stops its compiler.
+const AUTO_COMPILE_MS = 400;
+let autoTimer = 0;
+let inflight = null; // AbortController of the HTTP compile in flight
+
+async function runCompiler({ auto = false } = {}) {
   const src = codeEl.value;
+  clearTimeout(autoTimer);
+  if (inflight) inflight.abort();
+  if (useLocal()) return compileLocally({ auto });
+  const controller = new AbortController();
+  inflight = controller;
 
-  // UI state
-  runBtn.disabled = true;
-  runBtn.classList.add("opacity-60", "cursor-not-allowed");
   statusEl.textContent = "Running...";
-  exitInfoEl.textContent = "";
-
-  // Clear outputs
-  panels.tokens.textContent = "";
-  panels.symbols.textContent = "";
-  panels.tac.textContent = "";
-  panels.raw.textContent = "";
 
   try {
     const res = await fetch("/api/compile", {
       method: "POST",
       headers: { "Content-Type": "application/json" },
-      body: JSON.stringify({ code: src }),
+      body: JSON.stringify({ code: src, format: "compact" }),
+      signal: controller.signal,
     });
 
     const data = await res.json();
-
-    panels.tokens.textContent = data.tokens || "";
-    panels.symbols.textContent = data.symbolTable || "";
-    panels.tac.textContent = data.tac || "";
-    panels.raw.textContent =
-      (data.stdout || "") + (data.stderr ? "\n" + data.stderr : "");
-
-    exitInfoEl.textContent = `exit=${data.exitCode}`;
+    showResult(data);
     statusEl.textContent = data.ok ? "Done" : "Error";
 
-    // Auto-switch to Raw if error
-    if (!data.ok) setActiveTab("raw");
+    // Auto-switch to Raw if error (not while typing)
+    if (!data.ok && !auto) setActiveTab("raw");
   } catch (err) {
+    if (err.name === "AbortError") return; // superseded
     statusEl.textContent = "Network error";
-    panels.raw.textContent = String(err);
+    panels.raw.setText(String(err));
     setActiveTab("raw");
   } finally {
-    runBtn.disabled = false;
-    runBtn.classList.remove("opacity-60", "cursor-not-allowed");
+    if (inflight === controller) inflight = null;
+  }
+}
+
+function scheduleAutoCompile() {
+  clearTimeout(autoTimer);
+  if (inflight) inflight.abort(); // its source is already out of date
+  autoTimer = setTimeout(() => runCompiler({ auto: true }), AUTO_COMPILE_MS);
+}
+
+runBtn.addEventListener("click", () => runCompiler());
+
+// In-browser compiles: the WebAssembly build (tools/wasm.cpp) runs in a Web
+// Worker, so programs up to LOCAL_MAX_CHARS compile without a round trip and
+// the page never waits on it. Without WebAssembly, Workers or the built module,
+// and for bigger programs, everything goes to the server as before.
+const LOCAL_MAX_CHARS = 64 * 1024;
+const local = {
+  worker: null,
+  ready: false,
+  args: null, // the server's limit options (/api/config); no local compiles until known
+  timeoutMs: 0, // and its COMPILE_TIMEOUT_MS
+  running: null, // {id, auto} of the compile in the worker
+  queued: null, // the newest compile asked for meanwhile
+  nextId: 0,
+  timer: 0,
+};
+
+// The in-browser compiler runs under the server's limits and timeout, so both give the same result.
+async function loadLocalConfig() {
+  try {
+    const res = await fetch("/api/config");
+    if (!res.ok) return;
+    const config = await res.json();
+    local.timeoutMs = config.timeoutMs;
+    local.args = config.limitArgs.join(" ");
+  } catch {
+    // older server or offline: keep compiling on the server
   }
 }
 
-runBtn.addEventListener("click", runCompiler);
+function startLocalCompiler() {
+  if (!("Worker" in window) || typeof WebAssembly !== "object") return;
+  const worker = new Worker("compiler-worker.js");
+  local.worker = worker;
+  local.ready = false;
+  worker.onmessage = (ev) => {
+    const msg = ev.data;
+    if (msg.type === "ready") local.ready = true;
+    else if (msg.type === "unavailable") stopLocalCompiler();
+    else if (local.running && msg.id === local.running.id) finishLocal(msg);
+  };
+  worker.onerror = () => stopLocalCompiler();
+}
+
+function stopLocalCompiler() {
+  if (local.worker) local.worker.terminate();
+  clearTimeout(local.timer);
+  local.worker = null;
+  local.ready = false;
+  local.running = null;
+  local.queued = null;
+}
+
+function useLocal() {
+  return local.ready && local.args !== null && codeEl.value.length <= LOCAL_MAX_CHARS;
+}
+
+// A compile in the worker cannot be interrupted, so requests made meanwhile
+// wait for it and only the newest one runs.
+function compileLocally({ auto = false } = {}) {
+  session.stale = true; // the server's copy stops following the editor
+  local.queued = { auto };
+  if (!local.running) runLocal();
+}
+
+function runLocal() {
+  const { auto } = local.queued;
+  local.queued = null;
+  local.running = { id: ++local.nextId, auto };
+  statusEl.textContent = "Running...";
+  // a runaway compile takes the worker with it; start a fresh one
+  local.timer = setTimeout(() => {
+    stopLocalCompiler();
+    showResult({ exitCode: -1, stderr: `Compilation timed out after ${local.timeoutMs} ms` });
+    statusEl.textContent = "Error";
+    startLocalCompiler();
+  }, local.timeoutMs);
+  local.worker.postMessage({ id: local.running.id, code: codeEl.value, args: local.args });
+}
+
+function finishLocal(data) {
+  const { auto } = local.running;
+  clearTimeout(local.timer);
+  local.running = null;
+  if (local.queued) return runLocal(); // this result is already out of date
+  showResult(data);
+  statusEl.textContent = data.ok ? "Done (in browser)" : "Error";
+  if (!data.ok && !auto) setActiveTab("raw");
+}
+
+// Live session: every edit goes to the server over a WebSocket as a small
+// change and the output follows as you type (see COMPILE SESSIONS in server.js).
+// Run still does a full compile over HTTP.
+const session = {
+  socket: null,
+  text: "", // the document as the server has it
+  version: 0,
+  sections: {},
+  retryMs: 1000,
+  stale: false, // edits went to the in-browser compiler instead
+  rejected: false, // the server refused the document; compile over HTTP until retryMs passes
+};
+
+function openSession(socket) {
+  session.stale = false;
+  session.text = codeEl.value;
+  session.version++;
+  session.sections = { stdout: "", tokens: "", symbolTable: "", tac: "" };
+  socket.send(JSON.stringify({ type: "open", text: session.text, version: session.version }));
+}
+
+// One replacement covering everything between the common prefix and suffix.
+function changeBetween(a, b) {
+  const max = Math.min(a.length, b.length);
+  let start = 0;
+  while (start < max && a.charCodeAt(start) === b.charCodeAt(start)) start++;
+  let end = 0;
+  while (end < max - start && a.charCodeAt(a.length - 1 - end) === b.charCodeAt(b.length - 1 - end)) end++;
+  return { from: start, to: a.length - end, text: b.slice(start, b.length - end) };
+}
+
+function connectSession() {
+  if (!("WebSocket" in window)) return;
+  const socket = new WebSocket(`${location.protocol === "https:" ? "wss" : "ws"}://${location.host}/api/session`);
+
+  socket.addEventListener("open", () => {
+    session.socket = socket;
+    session.retryMs = 1000;
+    if (useLocal()) session.stale = true;
+    else openSession(socket);
+  });
+
+  socket.addEventListener("message", (ev) => {
+    const msg = JSON.parse(ev.data);
+    if (msg.type === "error") {
+      if (msg.resync) return openSession(socket); // out of step with the server: start over
+      // reopening would be refused again; fall back to HTTP and try the session later
+      session.rejected = true;
+      setTimeout(() => {
+        session.rejected = false;
+        session.stale = true; // the next edit reopens the document
+      }, session.retryMs);
+      session.retryMs = Math.min(session.retryMs * 2, 30000);
+      scheduleAutoCompile();
+      return;
+    }
+    if (msg.type !== "result") return;
+    session.retryMs = 1000;
+    for (const [name, p] of Object.entries(msg.patches)) {
+      const old = session.sections[name];
+      session.sections[name] = old.slice(0, p.at) + p.text + old.slice(p.at + p.remove);
+    }
+    showResult({ ...session.sections, exitCode: msg.exitCode, stderr: msg.stderr });
+    if (msg.version === session.version) statusEl.textContent = msg.ok ? `Live (${msg.ms} ms)` : `Live: ${msg.diagnostics.length} problem(s)`;
+  });
+
+  socket.addEventListener("close", () => {
+    session.socket = null;
+    setTimeout(connectSession, session.retryMs);
+    session.retryMs = Math.min(session.retryMs * 2, 30000);
+  });
+}
+
+codeEl.addEventListener("input", () => {
+  if (useLocal()) return compileLocally({ auto: true });
+  if (!session.socket || session.rejected) return scheduleAutoCompile();
+  if (session.stale) return openSession(session.socket);
+  const change = changeBetween(session.text, codeEl.value);
+  session.text = codeEl.value;
+  session.version++;
+  session.socket.send(JSON.stringify({ type: "edit", version: session.version, changes: [change] }));
+  statusEl.textContent = "Compiling...";
+});
+
+loadSampleBtn.addEventListener("click", () => {
+  if (useLocal()) compileLocally({ auto: true });
+  else if (session.socket && !session.rejected) openSession(session.socket);
+  else scheduleAutoCompile();
+});
+
+loadLocalConfig();
+startLocalCompiler();
+connectSession();
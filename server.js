@@ -1,12 +1,70 @@
 const express = require("express");
 const path = require("path");
-const { spawn } = require("node:child_process");
+const { spawn, spawnSync } = require("node:child_process");
 const fs = require("node:fs");
+const os = require("node:os");
+const crypto = require("node:crypto");
+const zlib = require("node:zlib");
+const { Registry } = require("./metrics");
+const websocket = require("./ws");
 
 const app = express();
-const PORT = 3000;
+const PORT = Number(process.env.PORT) || 3000;
 
-app.use(express.json({ limit: "1mb" }));
+// Where the compiler binary lives; `npm run build:compiler` builds it from bin/compiler.cpp.
+const COMPILER_PATH =
+  process.env.COMPILER_PATH || path.join(__dirname, "bin", process.platform === "win32" ? "compiler.exe" : "compiler");
+
+// How /api/compile runs the compiler:
+//   spawn : a fresh process per request, no limit (default)
+//   pool  : at most POOL_SIZE compilers at once, further requests wait in a
+//           FIFO queue; a process is spawned ahead for the next request with
+//           the same arguments, so spawn latency is off the request path
+//   cache : pool, plus an LRU of CACHE_SIZE results keyed by (arguments, source)
+const COMPILE_MODE = process.env.COMPILE_MODE || "spawn";
+const POOL_SIZE = Math.max(1, Number(process.env.POOL_SIZE) || os.cpus().length);
+const CACHE_SIZE = Math.max(1, Number(process.env.CACHE_SIZE) || 256);
+// A compiler still running after this long is killed and the request answered as a timeout.
+const COMPILE_TIMEOUT_MS = Math.max(1, Number(process.env.COMPILE_TIMEOUT_MS) || 10000);
+
+// Limits enforced inside the compiler (see RESOURCE LIMITS in compiler.cpp); it stops with a
+// "Limit error" diagnostic well before the hard kill above. 0 turns a limit off.
+function envLimit(name, fallback) {
+  const v = process.env[name];
+  return v !== undefined && v !== "" && Number(v) >= 0 ? Number(v) : fallback;
+}
+const COMPILER_LIMITS = {
+  "max-tokens": envLimit("MAX_TOKENS", 200000),
+  "max-nodes": envLimit("MAX_NODES", 400000),
+  "max-depth": envLimit("MAX_DEPTH", 500),
+  "max-temps": envLimit("MAX_TEMPS", 400000),
+  "time-budget-ms": envLimit("TIME_BUDGET_MS", Math.floor(COMPILE_TIMEOUT_MS / 2)),
+};
+const BODY_LIMIT = process.env.BODY_LIMIT || "1mb";
+// /api/compile/stream never buffers the program, so it can take far more than BODY_LIMIT;
+// the same cap applies to a session's document.
+const STREAM_BODY_LIMIT = Math.max(1, Number(process.env.STREAM_BODY_LIMIT) || 64 * 1024 * 1024);
+// The limits above are sized for BODY_LIMIT programs and would turn most streamed ones
+// away, so /api/compile/stream has its own, grown with STREAM_BODY_LIMIT: every token
+// takes at least a byte of source, and there are at most about two AST nodes or
+// temporaries per byte. Nesting depth is not a matter of size and stays the same.
+const STREAM_TIMEOUT_MS = Math.max(1, Number(process.env.STREAM_TIMEOUT_MS) || 6 * COMPILE_TIMEOUT_MS);
+const STREAM_LIMITS = {
+  "max-tokens": envLimit("STREAM_MAX_TOKENS", STREAM_BODY_LIMIT),
+  "max-nodes": envLimit("STREAM_MAX_NODES", 2 * STREAM_BODY_LIMIT),
+  "max-depth": COMPILER_LIMITS["max-depth"],
+  "max-temps": envLimit("STREAM_MAX_TEMPS", 2 * STREAM_BODY_LIMIT),
+  "time-budget-ms": envLimit("STREAM_TIME_BUDGET_MS", Math.floor(STREAM_TIMEOUT_MS / 2)),
+};
+const STREAM_STDERR_LIMIT = 64 * 1024; // diagnostics kept for the final line; the rest is dropped
+// Each WebSocket session keeps one compiler process running.
+const MAX_SESSIONS = Math.max(0, envLimit("MAX_SESSIONS", 64));
+if (!["spawn", "pool", "cache"].includes(COMPILE_MODE)) {
+  console.error(`Unknown COMPILE_MODE '${COMPILE_MODE}' (expected spawn, pool or cache)`);
+  process.exit(1);
+}
+
+app.use(express.json({ limit: BODY_LIMIT }));
 
 // Serve frontend from /public using express.static (standard Express way) [web:82][web:98]
 app.use(express.static(path.join(__dirname, "public")));
@@ -36,71 +94,798 @@ function splitCompilerOutput(stdoutText) {
   return { tokens, symbolTable, tac, raw: out };
 }
 
-app.post("/api/compile", async (req, res) => {
-  const code = req.body && req.body.code ? String(req.body.code) : "";
+// What /api/compile returns. body.format:
+//   "full" (default): stdout plus tokens/symbolTable/tac, which repeat parts of stdout
+//   "compact": only the split sections; stdout only when the output could not be split
+//              (e.g. a syntax error after TOKENS:), so nothing is sent twice
+// body.sections ("tokens,tac" or an array) keeps only the named ones of
+// stdout, tokens, symbolTable and tac. ok, exitCode and stderr are always included.
+const SECTIONS = ["stdout", "tokens", "symbolTable", "tac"];
 
-  // Optional: save last input for debugging/demo
-  // fs.writeFileSync(path.join(__dirname, "last_input.txt"), code, "utf8");
+function requestedSections(body) {
+  const raw = body ? body.sections : undefined;
+  if (raw === undefined || raw === null || raw === "") return null;
+  const names = (Array.isArray(raw) ? raw : String(raw).split(",")).map((n) => String(n).trim());
+  const unknown = names.filter((n) => !SECTIONS.includes(n));
+  if (unknown.length) throw new Error(`Unknown section(s): ${unknown.join(", ")} (expected ${SECTIONS.join(", ")})`);
+  return new Set(names);
+}
 
-  const exePath = path.join(__dirname, "bin", "compiler.exe");
-  if (!fs.existsSync(exePath)) {
-    return res.status(500).json({
-      ok: false,
-      exitCode: -1,
-      stdout: "",
-      stderr: `compiler.exe not found at: ${exePath}\nPut your compiled C++ compiler in mini-compiler-web/bin/compiler.exe`,
-      tokens: "",
-      symbolTable: "",
-      tac: "",
-    });
+function compileResponse(body, result) {
+  const compact = body && body.format === "compact";
+  const wanted = requestedSections(body);
+  const parts = result.unsplit ? { tokens: "", symbolTable: "", tac: "" } : splitCompilerOutput(result.stdout);
+  const split = parts.tokens !== "";
+  const out = { ok: result.ok, exitCode: result.exitCode, stderr: result.stderr };
+  const fields = {
+    stdout: compact && split ? undefined : result.stdout,
+    tokens: parts.tokens,
+    symbolTable: parts.symbolTable,
+    tac: parts.tac,
+  };
+  for (const name of SECTIONS) {
+    if (fields[name] === undefined || (wanted && !wanted.has(name))) continue;
+    if (compact && fields[name] === "") continue;
+    out[name] = fields[name];
   }
+  return out;
+}
+
+// Compression of JSON responses, negotiated from Accept-Encoding. Small bodies are
+// sent as is; levels favour latency, since every response is compressed fresh.
+const COMPRESS_MIN_BYTES = 1024;
+
+function pickEncoding(acceptEncoding) {
+  const q = new Map();
+  for (const part of String(acceptEncoding || "").split(",")) {
+    const [name, ...params] = part.trim().toLowerCase().split(";");
+    if (!name) continue;
+    const qp = params.map((p) => /^\s*q=([0-9.]+)\s*$/.exec(p)).find(Boolean);
+    q.set(name, qp ? Number(qp[1]) : 1);
+  }
+  const weight = (name) => (q.has(name) ? q.get(name) : q.has("*") ? q.get("*") : 0);
+  const best = ["br", "gzip"].filter((name) => weight(name) > 0).sort((a, b) => weight(b) - weight(a))[0];
+  return best || "identity";
+}
 
-  // Spawn compiler.exe and pipe stdin/stdout/stderr [web:78][web:96]
-  const child = spawn(exePath, [], { stdio: ["pipe", "pipe", "pipe"] });
+function compress(encoding, data) {
+  return new Promise((resolve, reject) => {
+    const done = (err, out) => (err ? reject(err) : resolve(out));
+    if (encoding === "br") {
+      zlib.brotliCompress(
+        data,
+        { params: { [zlib.constants.BROTLI_PARAM_QUALITY]: 4, [zlib.constants.BROTLI_PARAM_SIZE_HINT]: data.length } },
+        done,
+      );
+    } else zlib.gzip(data, { level: 5 }, done);
+  });
+}
 
-  let stdout = "";
-  let stderr = "";
+async function sendJson(req, res, status, obj) {
+  const json = Buffer.from(JSON.stringify(obj));
+  res.status(status).type("application/json").vary("Accept-Encoding");
+  let encoding = json.length >= COMPRESS_MIN_BYTES ? pickEncoding(req.headers["accept-encoding"]) : "identity";
+  let payload = json;
+  if (encoding !== "identity") {
+    try {
+      payload = await compress(encoding, json);
+      res.set("Content-Encoding", encoding);
+    } catch {
+      encoding = "identity";
+    }
+  }
+  responseBytes.inc({ encoding }, payload.length);
+  res.send(payload);
+}
+
+// Optimization level forwarded to the compiler as -O<n>; anything else falls back to its default.
+// --stats=time is always on: its phase timings feed /metrics and are removed from what users
+// see. Plain --stats would also walk every structure for the mem.* rows, which /metrics skips.
+function compilerArgs(body, limits = COMPILER_LIMITS) {
+  const level = body ? Number(body.optLevel) : NaN;
+  return [...([0, 1, 2].includes(level) ? [`-O${level}`] : []), "--stats=time", ...limitArgs(limits)];
+}
+
+// Limits as options; the in-browser compiler gets COMPILER_LIMITS from /api/config.
+function limitArgs(limits = COMPILER_LIMITS) {
+  return Object.entries(limits).map(([name, value]) => `--${name}=${value}`);
+}
+
+// Splits the compiler's "STATS:" block (key value lines) off its stderr.
+function extractStats(stderrText) {
+  const stats = new Map();
+  const lines = (stderrText || "").split("\n");
+  const start = lines.indexOf("STATS:");
+  if (start === -1) return { stats, stderr: stderrText || "" };
+
+  let end = start + 1;
+  for (; end < lines.length; end++) {
+    const m = /^(\S+)\s+(\S+)$/.exec(lines[end]);
+    if (!m) break;
+    stats.set(m[1], m[2]);
+  }
+  lines.splice(start, end - start);
+  return { stats, stderr: lines.join("\n") };
+}
+
+// Starts a compiler that waits for its program on stdin; collects its output from the start.
+function startCompiler(args) {
+  const child = spawn(COMPILER_PATH, args, { stdio: ["pipe", "pipe", "pipe"] });
+  const run = { child, stdout: "", stderr: "", exitCode: null, error: null, timedOut: false };
 
   child.stdout.setEncoding("utf8");
   child.stderr.setEncoding("utf8");
-
   child.stdout.on("data", (chunk) => {
-    stdout += chunk;
+    run.stdout += chunk;
   });
   child.stderr.on("data", (chunk) => {
-    stderr += chunk;
+    run.stderr += chunk;
+  });
+  child.stdin.on("error", () => {}); // the compiler may exit before reading everything
+
+  run.done = new Promise((resolve) => {
+    child.on("error", (err) => {
+      run.error = err;
+      resolve();
+    });
+    child.on("close", (exitCode) => {
+      run.exitCode = exitCode;
+      resolve();
+    });
+  });
+  return run;
+}
+
+// What a compile the client gave up on resolves to.
+function cancelledResult(stdout = "", stderr = "") {
+  return { exitCode: -1, stdout, stderr: stderr + "Compilation cancelled by the client", spawnError: false, timedOut: false, cancelled: true };
+}
+
+// Sends the program to a started compiler, then END so it exits; aborting `signal` kills it. [web:78]
+async function finishCompiler(run, code, signal) {
+  if (!run.error) run.child.stdin.end(code);
+  const timer = setTimeout(() => {
+    run.timedOut = true;
+    run.child.kill("SIGKILL");
+  }, COMPILE_TIMEOUT_MS);
+  const cancel = () => {
+    run.cancelled = true;
+    run.child.kill("SIGKILL");
+  };
+  if (signal) {
+    if (signal.aborted) cancel();
+    else signal.addEventListener("abort", cancel, { once: true });
+  }
+  await run.done;
+  clearTimeout(timer);
+  if (signal) signal.removeEventListener("abort", cancel);
+  if (run.error) {
+    return { exitCode: -1, stdout: run.stdout, stderr: run.stderr + "\n" + String(run.error), spawnError: true };
+  }
+  if (run.cancelled) return cancelledResult(run.stdout, run.stderr);
+  if (run.timedOut) {
+    const note = `Compilation timed out after ${COMPILE_TIMEOUT_MS} ms`;
+    return { exitCode: -1, stdout: run.stdout, stderr: run.stderr + note, spawnError: false, timedOut: true };
+  }
+  return { exitCode: run.exitCode, stdout: run.stdout, stderr: run.stderr, spawnError: false, timedOut: false };
+}
+
+class CompilerPool {
+  constructor(size) {
+    this.size = size;
+    this.active = 0;
+    this.queue = [];
+    this.spares = new Map(); // arguments -> started compilers waiting for a program
+    this.spareCount = 0;
+  }
+
+  compile(code, args, signal) {
+    return this.schedule(() => this.execute(code, args, signal), signal);
+  }
+
+  // Runs task() (returning a promise) once a worker slot is free; a job whose
+  // signal aborts while it waits leaves the queue without running.
+  schedule(task, signal) {
+    return new Promise((resolve, reject) => {
+      const job = { task, resolve, reject, signal, onAbort: null };
+      if (signal) {
+        if (signal.aborted) return resolve(cancelledResult());
+        job.onAbort = () => {
+          const k = this.queue.indexOf(job);
+          if (k === -1) return;
+          this.queue.splice(k, 1);
+          resolve(cancelledResult());
+        };
+        signal.addEventListener("abort", job.onAbort, { once: true });
+      }
+      this.queue.push(job);
+      this.pump();
+    });
+  }
+
+  pump() {
+    while (this.active < this.size && this.queue.length > 0) {
+      const job = this.queue.shift();
+      if (job.signal) job.signal.removeEventListener("abort", job.onAbort); // the task watches it from here
+      this.active++;
+      // a task that throws or rejects still gives its slot back, and its caller sees the error
+      Promise.resolve()
+        .then(job.task)
+        .then(job.resolve, job.reject)
+        .finally(() => {
+          this.active--;
+          this.pump();
+        });
+    }
+  }
+
+  async execute(code, args, signal) {
+    const key = args.join(" ");
+    const spares = this.spares.get(key) || [];
+    let run = spares.pop();
+    if (run) this.spareCount--;
+    else run = startCompiler(args);
+
+    const result = await finishCompiler(run, code, signal);
+    if (!result.spawnError && this.spareCount < this.size) {
+      spares.push(startCompiler(args));
+      this.spares.set(key, spares);
+      this.spareCount++;
+    }
+    return result;
+  }
+}
+
+class ResultCache {
+  constructor(capacity) {
+    this.capacity = capacity;
+    this.entries = new Map(); // insertion order doubles as recency order
+  }
+
+  static key(code, args) {
+    return crypto.createHash("sha256").update(args.join(" ")).update("\0").update(code).digest("hex");
+  }
+
+  get(key) {
+    const hit = this.entries.get(key);
+    if (hit === undefined) return undefined;
+    this.entries.delete(key);
+    this.entries.set(key, hit);
+    return hit;
+  }
+
+  set(key, value) {
+    this.entries.delete(key);
+    this.entries.set(key, value);
+    if (this.entries.size > this.capacity) this.entries.delete(this.entries.keys().next().value);
+  }
+}
+
+const pool = COMPILE_MODE === "spawn" ? null : new CompilerPool(POOL_SIZE);
+const cache = COMPILE_MODE === "cache" ? new ResultCache(CACHE_SIZE) : null;
+
+// Resolves to { exitCode, stdout, stderr, spawnError, timedOut, cancelled?, cached }.
+async function compile(code, args, signal) {
+  const key = cache ? ResultCache.key(code, args) : "";
+  if (cache) {
+    const hit = cache.get(key);
+    if (hit) return { ...hit, cached: true };
+  }
+  const result = pool ? await pool.compile(code, args, signal) : await finishCompiler(startCompiler(args), code, signal);
+  if (cache && !result.spawnError && !result.timedOut && !result.cancelled) cache.set(key, result);
+  return { ...result, cached: false };
+}
+
+// =========================================================
+// METRICS (GET /metrics, Prometheus text format)
+// =========================================================
+const metrics = new Registry();
+const requestsTotal = metrics.counter(
+  "mini_compile_requests_total",
+  "Compile requests by outcome (ok, compile_error, limit, crash, timeout, cancelled).",
+);
+const requestSeconds = metrics.histogram(
+  "mini_compile_request_duration_seconds",
+  "Time from receiving a compile request to sending the response.",
+  [0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10],
+);
+const inputBytes = metrics.histogram("mini_compile_input_bytes", "Size of the submitted source code.", [
+  64, 256, 1024, 4096, 16384, 65536, 262144, 1048576,
+]);
+const phaseSeconds = metrics.histogram(
+  "mini_compiler_phase_duration_seconds",
+  "Compiler phase times reported by --stats (lex, parse, semantic, tac, opt), uncached compiles only.",
+  [0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5],
+);
+const passSeconds = metrics.counter("mini_compiler_pass_seconds_total", "Time spent in each optimization pass, summed over uncached compiles.");
+const cacheLookups = metrics.counter("mini_compile_cache_lookups_total", "Result cache lookups by result (hit, miss).");
+const responseBytes = metrics.counter(
+  "mini_compile_response_bytes_total",
+  "Bytes of /api/compile response bodies as sent, by content encoding (br, gzip, identity).",
+);
+metrics.gauge("mini_compile_cache_hit_ratio", "Share of result cache lookups that hit (0 without a cache).", () => {
+  const hits = cacheLookups.get({ result: "hit" });
+  const total = hits + cacheLookups.get({ result: "miss" });
+  return total ? hits / total : 0;
+});
+let activeSpawns = 0; // running compilers in spawn mode, where there is no pool to ask
+metrics.gauge("mini_compile_queue_depth", "Compile requests waiting for a pool worker.", () => (pool ? pool.queue.length : 0));
+metrics.gauge("mini_compile_active_workers", "Compilers currently running for a request.", () => (pool ? pool.active : activeSpawns));
+
+function outcomeOf(result) {
+  if (result.cancelled) return "cancelled";
+  if (result.timedOut) return "timeout";
+  if (result.spawnError) return "crash";
+  if (result.exitCode === 0) return "ok";
+  if (result.exitCode === 1) {
+    // the compiler reports every diagnosed error with exit code 1
+    return /^Limit error/m.test(result.stderr) ? "limit" : "compile_error";
+  }
+  return "crash"; // killed by a signal or an unexpected exit code
+}
+
+function recordCompilerStats(stats) {
+  for (const [key, value] of stats) {
+    const phase = /^phase\.(.+)\.ms$/.exec(key);
+    if (phase) phaseSeconds.observe(Number(value) / 1000, { phase: phase[1] });
+    const pass = /^pass\.(.+)\.ms$/.exec(key);
+    if (pass) passSeconds.inc({ pass: pass[1] }, Number(value) / 1000);
+  }
+}
+
+app.get("/metrics", (req, res) => {
+  res.type("text/plain; version=0.0.4").send(metrics.render());
+});
+
+// What the page needs to compile like the server:
+//   {"limitArgs": ["--max-tokens=200000", ...], "timeoutMs": 10000}
+app.get("/api/config", (req, res) => {
+  res.json({ limitArgs: limitArgs(), timeoutMs: COMPILE_TIMEOUT_MS });
+});
+
+app.post("/api/compile", async (req, res) => {
+  const started = process.hrtime.bigint();
+  const code = req.body && req.body.code ? String(req.body.code) : "";
+  inputBytes.observe(Buffer.byteLength(code));
+  res.on("finish", () => requestSeconds.observe(Number(process.hrtime.bigint() - started) / 1e9));
+
+  // Optional: save last input for debugging/demo
+  // fs.writeFileSync(path.join(__dirname, "last_input.txt"), code, "utf8");
+
+  try {
+    requestedSections(req.body);
+  } catch (err) {
+    return res.status(400).json({ ok: false, exitCode: -1, stderr: err.message });
+  }
+
+  // A client that goes away (e.g. an editor dropping a stale compile) frees its compiler or queue slot.
+  const abort = new AbortController();
+  res.on("close", () => {
+    if (!res.writableFinished) abort.abort();
   });
 
-  child.on("error", (err) => {
-    return res.status(500).json({
-      ok: false,
-      exitCode: -1,
-      stdout,
-      stderr: stderr + "\n" + String(err),
-      tokens: "",
-      symbolTable: "",
-      tac: "",
+  // Spawn the compiler and pipe stdin/stdout/stderr [web:78][web:96]
+  if (!pool) activeSpawns++;
+  const result = await compile(code, compilerArgs(req.body), abort.signal);
+  if (!pool) activeSpawns--;
+  if (result.cancelled) {
+    requestsTotal.inc({ outcome: "cancelled" });
+    return; // nobody is waiting for the answer
+  }
+  const { exitCode, stdout, spawnError, timedOut, cached } = result;
+  const { stats, stderr } = extractStats(result.stderr);
+  if (cache) {
+    res.set("X-Compile-Cache", cached ? "hit" : "miss");
+    cacheLookups.inc({ result: cached ? "hit" : "miss" });
+  }
+  if (!cached) recordCompilerStats(stats);
+  requestsTotal.inc({ outcome: outcomeOf(result) });
+
+  if (spawnError || timedOut) {
+    // whatever the compiler printed before it failed is passed on unsplit
+    const failed = { ok: false, exitCode: -1, stdout, stderr, unsplit: true };
+    return sendJson(req, res, spawnError ? 500 : 504, compileResponse(req.body, failed));
+  }
+
+  await sendJson(req, res, 200, compileResponse(req.body, { ok: exitCode === 0, exitCode, stdout, stderr }));
+});
+
+// Streams one compile for /api/compile/stream: the request body goes straight to the
+// compiler's stdin and its stdout goes straight to the response, with backpressure both
+// ways, so neither the program nor the output is held in memory. Resolves when done.
+function streamCompile(req, res, args, started) {
+  return new Promise((resolve) => {
+    if (res.destroyed) return resolve(); // gave up while waiting for a pool slot
+    const child = spawn(COMPILER_PATH, args, { stdio: ["pipe", "pipe", "pipe"] });
+    const send = (event) => res.write(JSON.stringify(event) + "\n");
+    let received = 0;
+    let stderrText = "";
+    let rejected = ""; // why the request was cut short, if it was
+    let spawnError = null;
+    let timedOut = false;
+    let finished = false;
+
+    const timer = setTimeout(() => {
+      timedOut = true;
+      child.kill("SIGKILL");
+    }, STREAM_TIMEOUT_MS);
+
+    req.on("data", (chunk) => {
+      received += chunk.length;
+      if (received > STREAM_BODY_LIMIT && !rejected) {
+        rejected = `Program larger than ${STREAM_BODY_LIMIT} bytes`;
+        req.unpipe(child.stdin);
+        req.resume(); // drain the rest so the response can still be sent
+        child.kill("SIGKILL");
+      }
+    });
+    req.pipe(child.stdin);
+    child.stdin.on("error", () => {}); // the compiler may exit before reading everything
+
+    child.stdout.setEncoding("utf8");
+    child.stdout.on("data", (chunk) => {
+      if (!send({ stdout: chunk })) {
+        child.stdout.pause();
+        res.once("drain", () => child.stdout.resume());
+      }
     });
+    child.stderr.setEncoding("utf8");
+    child.stderr.on("data", (chunk) => {
+      if (stderrText.length < STREAM_STDERR_LIMIT) stderrText += chunk;
+    });
+
+    // The client went away: nobody is waiting for the rest.
+    res.on("close", () => {
+      if (!finished) child.kill("SIGKILL");
+    });
+
+    const finish = (exitCode) => {
+      if (finished) return;
+      finished = true;
+      clearTimeout(timer);
+      inputBytes.observe(received);
+
+      const extracted = extractStats(stderrText);
+      let stderr = extracted.stderr;
+      if (spawnError) stderr += "\n" + String(spawnError);
+      else if (timedOut) stderr += `Compilation timed out after ${STREAM_TIMEOUT_MS} ms`;
+      else if (rejected) stderr += rejected;
+      const result = { exitCode: spawnError || timedOut || rejected ? -1 : exitCode, stderr, spawnError: !!spawnError, timedOut };
+
+      recordCompilerStats(extracted.stats);
+      requestsTotal.inc({ outcome: rejected ? "limit" : outcomeOf(result) });
+      requestSeconds.observe(Number(process.hrtime.bigint() - started) / 1e9);
+      if (!res.writableEnded && !res.destroyed) {
+        send({ done: true, ok: result.exitCode === 0, exitCode: result.exitCode, stderr, timedOut });
+        res.end();
+      }
+      resolve();
+    };
+    child.on("error", (err) => {
+      spawnError = err;
+      finish(-1);
+    });
+    child.on("close", finish);
   });
+}
+
+// Raw-body variant of /api/compile for large programs. The body is the source itself
+// (any content type except JSON), options are query parameters (?optLevel=2). The reply
+// is NDJSON sent with chunked encoding as the compiler produces it:
+//   {"stdout": "..."}      pieces of the compiler's stdout, in order
+//   {"done": true, "ok": .., "exitCode": .., "stderr": "..", "timedOut": ..}   last line
+// Results are not cached, whatever COMPILE_MODE says; in pool/cache mode a run still
+// takes a pool slot, so the concurrency limit holds. Runs use STREAM_LIMITS and
+// STREAM_TIMEOUT_MS (STREAM_MAX_TOKENS, STREAM_MAX_NODES, STREAM_MAX_TEMPS and
+// STREAM_TIME_BUDGET_MS override them) instead of the /api/compile limits.
+app.post("/api/compile/stream", (req, res) => {
+  const started = process.hrtime.bigint();
+  if (req.is("application/json")) {
+    return res.status(415).json({ ok: false, stderr: "Send the program itself as the request body, e.g. Content-Type: text/plain" });
+  }
+
+  res.status(200).type("application/x-ndjson").set("Cache-Control", "no-store");
+  res.flushHeaders();
+  const args = compilerArgs(req.query, STREAM_LIMITS);
+  if (pool) {
+    req.pause(); // until a worker slot frees up
+    pool.schedule(() => streamCompile(req, res, args, started)).catch((err) => {
+      if (!res.writableEnded && !res.destroyed) res.end(JSON.stringify({ done: true, ok: false, exitCode: -1, stderr: String(err) }) + "\n");
+    });
+  } else {
+    activeSpawns++;
+    streamCompile(req, res, args, started).then(() => activeSpawns--);
+  }
+});
+
+// =========================================================
+// COMPILE SESSIONS (WebSocket /api/session)
+// =========================================================
+// Compile-as-you-type: the client opens a document, then sends only its edits;
+// each session keeps a compiler running in --session mode, which relexes and
+// reparses just what an edit touched (see SESSION MODE in compiler.cpp).
+// Edits arriving while a compile runs are batched into the next one.
+// JSON text messages, client -> server:
+//   {"type": "open", "text": "...", "version": 1, "optLevel": 2}   (re)start the document
+//   {"type": "edit", "version": 2, "changes": [{"from": 10, "to": 12, "text": "x"}]}
+//       replaces [from, to) of the document (UTF-16 offsets, changes applied in order)
+// server -> client:
+//   {"type": "result", "version": 2, "ok": .., "exitCode": .., "ms": .., "stderr": "..",
+//    "diagnostics": [{"severity": "error", "line": 3, "col": 5, "message": ".."}],
+//    "patches": {"tac": {"at": 120, "remove": 3, "text": ".."}, ...}}
+//       version is the last edit the result includes; a patch turns the previous
+//       result's section (stdout, tokens, symbolTable, tac; all "" at first) into
+//       this one's, and unchanged sections have none
+//   {"type": "error", "message": "..", "resync": ..}   a rejected message; resync is true
+//       when an edit did not fit the server's copy of the document (reopen to resync),
+//       false when reopening would only be rejected again (e.g. the program is too large)
+const sessionCompiles = metrics.counter(
+  "mini_session_compiles_total",
+  "Compiles in WebSocket sessions by outcome (ok, compile_error, limit, crash, timeout).",
+);
+const sessionSeconds = metrics.histogram(
+  "mini_session_compile_duration_seconds",
+  "Time from sending a session's compile to the compiler to its result.",
+  [0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 5],
+);
+const sessions = new Set();
+metrics.gauge("mini_sessions_active", "Open WebSocket compile sessions.", () => sessions.size);
+
+const SESSION_SECTIONS = ["stdout", "tokens", "symbolTable", "tac"];
+
+// One line of the compiler's stderr as an editor diagnostic.
+function diagnosticsOf(stderrText) {
+  const out = [];
+  for (const line of stderrText.split("\n")) {
+    const m = /^(Lexical error|Syntax error|Semantic error|Semantic warning|Limit error|Runtime error)(?: at (\d+):(\d+))?/.exec(line);
+    if (!m) continue;
+    out.push({
+      severity: m[1] === "Semantic warning" ? "warning" : "error",
+      line: m[2] ? Number(m[2]) : 0,
+      col: m[3] ? Number(m[3]) : 0,
+      message: line,
+    });
+  }
+  return out;
+}
+
+// The smallest single replacement turning a into b (common prefix and suffix kept).
+function patchFor(a, b) {
+  const max = Math.min(a.length, b.length);
+  let start = 0;
+  while (start < max && a.charCodeAt(start) === b.charCodeAt(start)) start++;
+  let end = 0;
+  while (end < max - start && a.charCodeAt(a.length - 1 - end) === b.charCodeAt(b.length - 1 - end)) end++;
+  return { at: start, remove: a.length - start - end, text: b.slice(start, b.length - end) };
+}
 
-  // Send the program to compiler stdin, then END so it exits. [web:78]
-  child.stdin.write(code);
-  child.stdin.end();
-
-  child.on("close", (exitCode) => {
-    const parts = splitCompilerOutput(stdout);
-    res.json({
-      ok: exitCode === 0,
-      exitCode,
-      stdout,
-      stderr,
+class CompileSession {
+  constructor(socket) {
+    this.socket = socket;
+    this.doc = "";
+    this.ascii = true; // UTF-16 offsets are byte offsets while the document is ASCII
+    this.version = 0;
+    this.optLevel = null;
+    this.child = null;
+    this.frames = null;
+    this.pending = null; // resolves the compile in flight
+    this.running = false;
+    this.dirty = false;
+    this.closed = false;
+    this.shown = Object.fromEntries(SESSION_SECTIONS.map((name) => [name, ""])); // what the client has
+
+    socket.on("message", (text) => this.onMessage(text));
+    socket.on("close", () => this.close());
+  }
+
+  onMessage(text) {
+    let msg;
+    try {
+      msg = JSON.parse(text);
+      if (msg.type === "open") this.open(msg);
+      else if (msg.type === "edit") this.edit(msg);
+      else throw new Error(`unknown message type '${msg.type}'`);
+    } catch (err) {
+      this.socket.send(JSON.stringify({ type: "error", message: err.message, resync: err.resync === true }));
+      return;
+    }
+    this.schedule();
+  }
+
+  open(msg) {
+    const text = typeof msg.text === "string" ? msg.text : "";
+    if (text.length > STREAM_BODY_LIMIT) throw new Error(`Program larger than ${STREAM_BODY_LIMIT} bytes`);
+    const level = Number(msg.optLevel);
+    const optLevel = [0, 1, 2].includes(level) ? level : null;
+    if (optLevel !== this.optLevel) this.stopCompiler(); // other arguments: a new process
+    this.optLevel = optLevel;
+    this.version = Number(msg.version) || 0;
+    this.replace(0, this.doc.length, text);
+  }
+
+  edit(msg) {
+    if (!Array.isArray(msg.changes)) throw new Error("edit needs a changes array");
+    for (const c of msg.changes) {
+      const from = Number(c.from);
+      const to = Number(c.to);
+      if (!Number.isInteger(from) || !Number.isInteger(to) || from < 0 || from > to || to > this.doc.length || typeof c.text !== "string") {
+        const err = new Error(`bad change ${JSON.stringify(c)} for a document of ${this.doc.length} characters`);
+        err.resync = true; // the client's copy has drifted from ours
+        throw err;
+      }
+      if (this.doc.length - (to - from) + c.text.length > STREAM_BODY_LIMIT) throw new Error(`Program larger than ${STREAM_BODY_LIMIT} bytes`);
+      this.replace(from, to, c.text);
+    }
+    this.version = Number(msg.version) || this.version + 1;
+  }
+
+  replace(from, to, text) {
+    const start = this.byteOffset(from);
+    const end = this.byteOffset(to);
+    this.doc = this.doc.slice(0, from) + text + this.doc.slice(to);
+    if (this.ascii && /[^\x00-\x7f]/.test(text)) this.ascii = false;
+    if (this.child) this.sendEdit(start, end, text);
+  }
+
+  byteOffset(index) {
+    return this.ascii ? index : Buffer.byteLength(this.doc.slice(0, index));
+  }
+
+  sendEdit(start, end, text) {
+    const bytes = Buffer.from(text);
+    this.child.stdin.write(`EDIT ${start} ${end} ${bytes.length}\n`);
+    this.child.stdin.write(bytes);
+  }
+
+  // A warm compiler holding the current document.
+  startCompiler() {
+    const args = ["--session", ...compilerArgs({ optLevel: this.optLevel })];
+    const child = spawn(COMPILER_PATH, args, { stdio: ["pipe", "pipe", "ignore"] });
+    child.stdin.on("error", () => {});
+    child.on("error", () => this.compilerGone(child));
+    child.on("close", () => this.compilerGone(child));
+    this.frames = { chunks: [], bytes: 0, header: null };
+    child.stdout.on("data", (chunk) => this.readResults(child, chunk));
+    this.child = child;
+    this.ascii = !/[^\x00-\x7f]/.test(this.doc);
+    this.sendEdit(0, 0, this.doc);
+  }
+
+  stopCompiler() {
+    if (this.child) this.child.kill("SIGKILL");
+    this.child = null;
+  }
+
+  compilerGone(child) {
+    if (this.child !== child) return;
+    this.child = null;
+    if (this.pending) this.pending({ exitCode: -1, stdout: "", stderr: "Compiler session ended unexpectedly", crashed: true });
+  }
+
+  // RESULT <exit code> <stdout bytes> <stderr bytes>\n<stdout><stderr>
+  readResults(child, chunk) {
+    const f = this.frames;
+    f.chunks.push(chunk);
+    f.bytes += chunk.length;
+    for (;;) {
+      if (!f.header) {
+        const buf = Buffer.concat(f.chunks);
+        const nl = buf.indexOf(10);
+        if (nl === -1) return;
+        const m = /^RESULT (\d+) (\d+) (\d+)$/.exec(buf.toString("latin1", 0, nl));
+        if (!m) return this.stopCompiler();
+        f.header = { exitCode: Number(m[1]), out: Number(m[2]), err: Number(m[3]) };
+        f.chunks = [buf.subarray(nl + 1)];
+        f.bytes = buf.length - nl - 1;
+      }
+      const { exitCode, out, err } = f.header;
+      if (f.bytes < out + err) return;
+      const buf = Buffer.concat(f.chunks);
+      f.header = null;
+      f.chunks = [buf.subarray(out + err)];
+      f.bytes = buf.length - out - err;
+      const result = { exitCode, stdout: buf.toString("utf8", 0, out), stderr: buf.toString("utf8", out, out + err) };
+      if (this.pending && this.child === child) this.pending(result);
+    }
+  }
+
+  schedule() {
+    if (this.running) this.dirty = true;
+    else this.run();
+  }
+
+  async run() {
+    this.running = true;
+    do {
+      this.dirty = false;
+      await this.compileOnce();
+    } while (this.dirty && !this.closed);
+    this.running = false;
+  }
+
+  compileOnce() {
+    if (!this.child) this.startCompiler();
+    const version = this.version;
+    const started = process.hrtime.bigint();
+    return new Promise((resolve) => {
+      const timer = setTimeout(() => {
+        this.pending({ exitCode: -1, stdout: "", stderr: `Compilation timed out after ${COMPILE_TIMEOUT_MS} ms`, timedOut: true });
+        this.stopCompiler(); // the next compile starts a fresh one with the document
+      }, COMPILE_TIMEOUT_MS);
+      this.pending = (result) => {
+        clearTimeout(timer);
+        this.pending = null;
+        this.push(version, result, Number(process.hrtime.bigint() - started) / 1e9);
+        resolve();
+      };
+      this.child.stdin.write("COMPILE\n");
+    });
+  }
+
+  push(version, result, seconds) {
+    const { stats, stderr } = extractStats(result.stderr);
+    const outcome = outcomeOf({ ...result, stderr, spawnError: !!result.crashed });
+    recordCompilerStats(stats);
+    sessionCompiles.inc({ outcome });
+    sessionSeconds.observe(seconds);
+    if (this.closed) return;
+
+    const parts = splitCompilerOutput(result.stdout);
+    const split = parts.tokens !== "";
+    const now = {
+      stdout: split ? "" : result.stdout,
       tokens: parts.tokens,
       symbolTable: parts.symbolTable,
       tac: parts.tac,
-    });
-  });
+    };
+    const patches = {};
+    for (const name of SESSION_SECTIONS) {
+      if (now[name] === this.shown[name]) continue;
+      patches[name] = patchFor(this.shown[name], now[name]);
+      this.shown[name] = now[name];
+    }
+    this.socket.send(
+      JSON.stringify({
+        type: "result",
+        version,
+        ok: result.exitCode === 0,
+        exitCode: result.exitCode,
+        ms: Math.round(seconds * 1e4) / 10,
+        stderr,
+        diagnostics: diagnosticsOf(stderr),
+        patches,
+      }),
+    );
+  }
+
+  close() {
+    this.closed = true;
+    this.stopCompiler();
+    sessions.delete(this);
+  }
+}
+
+// Every request passes -O<n>, --stats and the limit options, so a missing or older compiler
+// would fail each compile with "Unknown option". Check once with an empty program instead.
+function checkCompiler() {
+  const probe = spawnSync(COMPILER_PATH, compilerArgs({}), { input: "", encoding: "utf8", timeout: COMPILE_TIMEOUT_MS });
+  if (probe.error || probe.status !== 0) {
+    const reason = probe.error ? probe.error.message : (probe.stderr || "").trim() || `exit code ${probe.status}`;
+    console.error(`Compiler at ${COMPILER_PATH} is not usable: ${reason}`);
+    console.error("Build it from bin/compiler.cpp with `npm run build:compiler`, or point COMPILER_PATH at a current build.");
+    process.exit(1);
+  }
+}
+checkCompiler();
+
+const server = app.listen(PORT, () => {
+  console.log(`Mini Compiler Web IDE running at http://localhost:${PORT} (compile mode: ${COMPILE_MODE})`);
 });
 
-app.listen(PORT, () => {
-  console.log(`Mini Compiler Web IDE running at http://localhost:${PORT}`);
+server.on("upgrade", (req, socket, head) => {
+  if (new URL(req.url, "http://localhost").pathname !== "/api/session") return websocket.reject(socket, 404, "Not Found");
+  if (sessions.size >= MAX_SESSIONS) return websocket.reject(socket, 503, "Service Unavailable");
+  // room for a whole document plus its JSON escaping
+  const conn = websocket.accept(req, socket, head, { maxMessageBytes: 2 * STREAM_BODY_LIMIT + 1024 });
+  if (conn) sessions.add(new CompileSession(conn));
 });
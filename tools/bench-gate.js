@@ -0,0 +1,274 @@
+// bench-gate.js - performance regression gate over stored baselines
+// Runs the per-phase microbenchmarks (tools/bench.cpp, --json) and the
+// end-to-end load test (tools/loadtest.js, --json --samples). It stores the
+// raw samples as a JSON baseline keyed by commit and machine, and compares a
+// new run against a baseline. A metric regresses when both hold:
+//   - a one-sided Mann-Whitney U test says the new samples are slower
+//     (p < --alpha);
+//   - the median grew by more than --threshold percent.
+// The exit status is 1 if any metric regresses, so the gate can fail a CI step.
+//
+//   node tools/bench-gate.js save    --bench=PATH [--compiler=PATH] [options]
+//   node tools/bench-gate.js check   --bench=PATH [--compiler=PATH] [options]
+//   node tools/bench-gate.js compare OLD.json NEW.json [--alpha=A] [--threshold=P]
+//   node tools/bench-gate.js list
+//
+//   save       run, then store the result as <dir>/<machine>/<commit>.json
+//   check      run, then compare with the baseline (default: the newest one
+//              stored for this machine from another commit); --save also
+//              stores the new run
+//   compare    compare two stored results without running anything
+//   list       show the stored baselines for this machine
+//
+//   --bench=PATH          built tools/bench (g++ -std=c++17 -O2 -o bench tools/bench.cpp)
+//   --bench-args="..."    extra bench arguments (default: --reps=15)
+//   --compiler=PATH       compiler binary for the end-to-end run; omitted = no end-to-end metrics
+//   --loadtest-args="..." extra loadtest arguments (default: --duration=5 --concurrency=8)
+//   --modes=LIST          server modes measured end to end (default: spawn)
+//   --baseline=COMMIT     compare with this commit's baseline instead of the newest
+//   --dir=PATH            baseline directory (default: bench-baselines at the repo root)
+//   --machine=NAME        machine key (default: derived from host name, CPU model and core count)
+//   --alpha=A             significance level (default 0.01)
+//   --threshold=P         minimum median slowdown in percent (default 5)
+"use strict";
+
+const fs = require("node:fs");
+const os = require("node:os");
+const path = require("node:path");
+const { execFileSync } = require("node:child_process");
+
+const ROOT = path.join(__dirname, "..");
+
+function parseArgs(argv) {
+  const o = {
+    command: argv[0] || "",
+    files: [],
+    bench: "",
+    benchArgs: ["--reps=15"],
+    compiler: "",
+    loadtestArgs: ["--duration=5", "--concurrency=8"],
+    modes: ["spawn"],
+    baseline: "",
+    dir: path.join(ROOT, "bench-baselines"),
+    machine: "",
+    alpha: 0.01,
+    threshold: 5,
+    save: false,
+  };
+  for (const arg of argv.slice(1)) {
+    const m = /^--([a-z-]+)(?:=(.*))?$/.exec(arg);
+    if (!m) {
+      o.files.push(arg);
+      continue;
+    }
+    const [, name, v = ""] = m;
+    if (name === "bench") o.bench = path.resolve(v);
+    else if (name === "bench-args") o.benchArgs = v.split(/\s+/).filter(Boolean);
+    else if (name === "compiler") o.compiler = path.resolve(v);
+    else if (name === "loadtest-args") o.loadtestArgs = v.split(/\s+/).filter(Boolean);
+    else if (name === "modes") o.modes = v.split(",").filter(Boolean);
+    else if (name === "baseline") o.baseline = v;
+    else if (name === "dir") o.dir = path.resolve(v);
+    else if (name === "machine") o.machine = v;
+    else if (name === "alpha") o.alpha = Number(v);
+    else if (name === "threshold") o.threshold = Number(v);
+    else if (name === "save") o.save = true;
+    else throw new Error(`unknown option: --${name}`);
+  }
+  if (!o.machine) o.machine = machineKey();
+  return o;
+}
+
+// Baselines only compare meaningfully on the same hardware.
+function machineKey() {
+  const cpus = os.cpus();
+  const model = cpus.length ? cpus[0].model : "unknown-cpu";
+  const raw = `${os.hostname()}-${os.platform()}-${os.arch()}-${model}-${cpus.length}c`;
+  return raw.replace(/[^A-Za-z0-9.]+/g, "-").replace(/^-+|-+$/g, "").toLowerCase();
+}
+
+function commitKey() {
+  try {
+    const head = execFileSync("git", ["rev-parse", "--short=12", "HEAD"], { cwd: ROOT, encoding: "utf8" }).trim();
+    const dirty = execFileSync("git", ["status", "--porcelain", "--untracked-files=no"], { cwd: ROOT, encoding: "utf8" }).trim();
+    return dirty ? `${head}-dirty` : head;
+  } catch {
+    return "unknown";
+  }
+}
+
+// metric name -> { unit, samples }
+function runBenchmarks(o) {
+  const metrics = {};
+  if (!o.bench) throw new Error("--bench=PATH is required (build it with g++ -std=c++17 -O2 -o bench tools/bench.cpp)");
+  const out = execFileSync(o.bench, ["--json", ...o.benchArgs], { encoding: "utf8", maxBuffer: 64 << 20 });
+  for (const r of JSON.parse(out)) metrics[`${r.shape}/${r.phase}`] = { unit: "ns", samples: r.ns };
+
+  if (o.compiler) {
+    const loadtest = path.join(__dirname, "loadtest.js");
+    for (const mode of o.modes) {
+      const args = [loadtest, `--compiler=${o.compiler}`, `--mode=${mode}`, "--json", "--samples", ...o.loadtestArgs];
+      const res = JSON.parse(execFileSync(process.execPath, args, { encoding: "utf8", maxBuffer: 256 << 20 }));
+      metrics[`e2e/${mode}`] = { unit: "ms", samples: res.runs[mode].samples };
+    }
+  }
+  return metrics;
+}
+
+// Mann-Whitney U with the normal approximation (tie-corrected, continuity
+// corrected). Returns the one-sided p-value for "b tends to be larger than a".
+function mannWhitneyGreater(a, b) {
+  const n1 = a.length;
+  const n2 = b.length;
+  if (n1 === 0 || n2 === 0) return 1;
+  const all = a.map((v) => [v, 0]).concat(b.map((v) => [v, 1]));
+  all.sort((x, y) => x[0] - y[0]);
+
+  let rankSumB = 0;
+  let tieTerm = 0;
+  for (let i = 0; i < all.length; ) {
+    let j = i;
+    while (j < all.length && all[j][0] === all[i][0]) j++;
+    const rank = (i + 1 + j) / 2; // average of ranks i+1 .. j
+    for (let k = i; k < j; k++) if (all[k][1] === 1) rankSumB += rank;
+    const t = j - i;
+    tieTerm += t * t * t - t;
+    i = j;
+  }
+
+  const u = rankSumB - (n2 * (n2 + 1)) / 2;
+  const n = n1 + n2;
+  const mean = (n1 * n2) / 2;
+  const variance = ((n1 * n2) / 12) * (n + 1 - tieTerm / (n * (n - 1)));
+  if (variance <= 0) return u > mean ? 0 : 1;
+  const z = (u - mean - 0.5) / Math.sqrt(variance);
+  return 1 - normalCdf(z);
+}
+
+// Abramowitz-Stegun 7.1.26; plenty for a significance threshold.
+function normalCdf(z) {
+  const x = Math.abs(z) / Math.SQRT2;
+  const t = 1 / (1 + 0.3275911 * x);
+  const poly = t * (0.254829592 + t * (-0.284496736 + t * (1.421413741 + t * (-1.453152027 + t * 1.061405429))));
+  const erf = 1 - poly * Math.exp(-x * x);
+  return z >= 0 ? 0.5 * (1 + erf) : 0.5 * (1 - erf);
+}
+
+function median(xs) {
+  const s = [...xs].sort((x, y) => x - y);
+  const m = s.length >> 1;
+  return s.length === 0 ? 0 : s.length % 2 ? s[m] : (s[m - 1] + s[m]) / 2;
+}
+
+function compare(o, base, cur) {
+  const names = Object.keys(cur.metrics).filter((n) => base.metrics[n]);
+  const missing = Object.keys(cur.metrics).filter((n) => !base.metrics[n]);
+  let regressions = 0;
+
+  console.log(`baseline ${base.commit} (${base.date})  vs  current ${cur.commit} (${cur.date})`);
+  console.log(`machine ${cur.machine}; regression = p < ${o.alpha} and median +${o.threshold}% or more`);
+  console.log("");
+  console.log(
+    "metric".padEnd(24) + "unit".padStart(5) + "baseline".padStart(14) + "current".padStart(14) + "change".padStart(9) + "p".padStart(10) + "  verdict",
+  );
+  for (const name of names) {
+    const a = base.metrics[name].samples;
+    const b = cur.metrics[name].samples;
+    const ma = median(a);
+    const mb = median(b);
+    const change = ma > 0 ? ((mb - ma) / ma) * 100 : 0;
+    const pSlower = mannWhitneyGreater(a, b);
+    const pFaster = mannWhitneyGreater(b, a);
+    let verdict = "same";
+    if (pSlower < o.alpha && change > o.threshold) {
+      verdict = "SLOWER";
+      regressions++;
+    } else if (pFaster < o.alpha && change < -o.threshold) verdict = "faster";
+
+    const p = change >= 0 ? pSlower : pFaster;
+    console.log(
+      name.padEnd(24) +
+        cur.metrics[name].unit.padStart(5) +
+        ma.toFixed(ma < 100 ? 2 : 0).padStart(14) +
+        mb.toFixed(mb < 100 ? 2 : 0).padStart(14) +
+        `${change >= 0 ? "+" : ""}${change.toFixed(1)}%`.padStart(9) +
+        p.toExponential(1).padStart(10) +
+        "  " +
+        verdict,
+    );
+  }
+  for (const name of missing) console.log(`${name.padEnd(24)}  (not in baseline)`);
+  console.log("");
+  console.log(regressions ? `${regressions} significant slowdown(s)` : "no significant slowdowns");
+  return regressions;
+}
+
+function baselineDir(o) {
+  return path.join(o.dir, o.machine);
+}
+
+function storedBaselines(o) {
+  const dir = baselineDir(o);
+  if (!fs.existsSync(dir)) return [];
+  return fs
+    .readdirSync(dir)
+    .filter((f) => f.endsWith(".json"))
+    .map((f) => JSON.parse(fs.readFileSync(path.join(dir, f), "utf8")))
+    .sort((x, y) => (x.date < y.date ? -1 : x.date > y.date ? 1 : 0));
+}
+
+function save(o, result) {
+  const dir = baselineDir(o);
+  fs.mkdirSync(dir, { recursive: true });
+  const file = path.join(dir, `${result.commit}.json`);
+  fs.writeFileSync(file, JSON.stringify(result) + "\n");
+  console.log(`saved ${path.relative(process.cwd(), file)}`);
+}
+
+function run(o) {
+  return {
+    commit: commitKey(),
+    machine: o.machine,
+    date: new Date().toISOString(),
+    benchArgs: o.benchArgs,
+    loadtestArgs: o.compiler ? o.loadtestArgs : null,
+    metrics: runBenchmarks(o),
+  };
+}
+
+function main() {
+  const o = parseArgs(process.argv.slice(2));
+  if (o.command === "save") {
+    save(o, run(o));
+    return 0;
+  }
+  if (o.command === "list") {
+    for (const b of storedBaselines(o)) console.log(`${b.commit.padEnd(20)} ${b.date}  ${Object.keys(b.metrics).length} metrics`);
+    return 0;
+  }
+  if (o.command === "compare") {
+    if (o.files.length !== 2) throw new Error("compare needs OLD.json and NEW.json");
+    const [base, cur] = o.files.map((f) => JSON.parse(fs.readFileSync(f, "utf8")));
+    return compare(o, base, cur) ? 1 : 0;
+  }
+  if (o.command === "check") {
+    const commit = commitKey();
+    const stored = storedBaselines(o);
+    const base = o.baseline
+      ? stored.find((b) => b.commit === o.baseline)
+      : stored.filter((b) => b.commit !== commit).pop() || stored.pop();
+    if (!base) throw new Error(`no baseline${o.baseline ? ` for ${o.baseline}` : ""} in ${baselineDir(o)}; run 'save' first`);
+    const cur = run(o);
+    const regressions = compare(o, base, cur);
+    if (o.save) save(o, cur);
+    return regressions ? 1 : 0;
+  }
+  throw new Error("usage: bench-gate.js save|check|compare|list [options] (see the header of tools/bench-gate.js)");
+}
+
+try {
+  process.exitCode = main();
+} catch (err) {
+  console.error(err.message);
+  process.exitCode = 2;
+}
@@ -0,0 +1,344 @@
+// bench.cpp - per-phase microbenchmarks for the mini compiler
+// Times Lexer::tokenize, Parser::parse, SemanticAnalyzer::analyze and
+// TACGenerator::generate separately on synthetic programs, repeating each
+// measurement and reporting the median with its spread.
+//
+// Build:  g++ -std=c++17 -O2 -o bench tools/bench.cpp
+// Usage:  bench [--shape=wide|deep|idents|synthetic|all] [--size=N] [--reps=N] [--json]
+//              [--scaling [--csv]] [--corpus=DIR] [workload options of tools/gen.cpp, e.g. --seed=7 --depth=3]
+//   wide      : N short statements over a handful of variables
+//   deep      : N/64 assignments whose right side nests 64 levels deep
+//   idents    : N distinct, long identifiers, each declared and used
+//   synthetic : N statements from the workload generator (workload.h)
+// --corpus=DIR replays every file in DIR (the slow inputs saved by
+// tools/fuzz.cpp) as its own shape, through as many phases as it passes.
+// "held bytes" is the footprint of what the phase builds (see 4c in the
+// compiler). --json prints one object per (shape, phase) with every sample, for
+// scripts that compare runs. --scaling runs the shape (default synthetic)
+// at N/16, N/8, N/4, N/2 and N and reports time against input size per
+// phase, with the fitted exponent of time ~ tokens^k (1.0 is linear);
+// --csv prints the same points for plotting elsewhere.
+#define MINI_COMPILER_NO_MAIN
+#define MINI_COUNT_ALLOCS   // allocation counts come from the compiler's own hook
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"   // driver helpers the benchmark does not call
+#include "../bin/compiler.cpp"
+#pragma GCC diagnostic pop
+
+#include "workload.h"
+
+#include <cmath>
+#include <dirent.h>
+#include <fstream>
+
+// =========================================================
+// SYNTHETIC INPUTS
+// =========================================================
+static string wideProgram(int n) {
+    ostringstream o;
+    o << "int a; int b; int c; int d;\n";
+    for (int k = 0; k < n; k++) {
+        switch (k % 4) {
+            case 0: o << "a = b + " << k << " * c;\n"; break;
+            case 1: o << "b = a - d / 3;\n"; break;
+            case 2: o << "c = (a + b) * (c - " << k % 97 << ");\n"; break;
+            default: o << "d = a + b + c + d;\n"; break;
+        }
+    }
+    o << "print a + b + c + d;\n";
+    return o.str();
+}
+
+static string deepProgram(int n) {
+    const int depth = 64;   // keeps the recursive-descent parser far from the stack limit
+    ostringstream o;
+    o << "int x; int y;\ny = 1;\n";
+    for (int s = 0; s < max(1, n / depth); s++) {
+        o << "x = ";
+        for (int d = 0; d < depth; d++) o << "(";
+        o << "y";
+        for (int d = 0; d < depth; d++) o << (d % 3 == 0 ? " + " : d % 3 == 1 ? " * " : " - ") << (d + 1) << ")";
+        o << ";\ny = x;\n";
+    }
+    o << "print y;\n";
+    return o.str();
+}
+
+static string identsProgram(int n) {
+    auto name = [](int k) { return "identifier_number_" + to_string(k) + "_in_a_rather_long_program"; };
+    ostringstream o;
+    for (int k = 0; k < n; k++) o << "int " << name(k) << ";\n";
+    o << name(0) << " = 1;\n";
+    for (int k = 1; k < n; k++) o << name(k) << " = " << name(k - 1) << " + " << k << ";\n";
+    o << "print " << name(n - 1) << ";\n";
+    return o.str();
+}
+
+// AST nodes (statements and expressions) under a program.
+static size_t countNodes(const Expr* e) {
+    if (!e) return 0;
+    if (auto ix = dynamic_cast<const IndexExpr*>(e)) return 1 + countNodes(ix->index.get());
+    if (auto c = dynamic_cast<const CallExpr*>(e)) {
+        size_t n = 1;
+        for (const auto& a : c->args) n += countNodes(a.get());
+        return n;
+    }
+    if (auto u = dynamic_cast<const UnaryExpr*>(e)) return 1 + countNodes(u->rhs.get());
+    if (auto b = dynamic_cast<const BinaryExpr*>(e)) return 1 + countNodes(b->lhs.get()) + countNodes(b->rhs.get());
+    return 1;
+}
+
+static size_t countNodes(const Stmt* s) {
+    if (!s) return 0;
+    if (auto a = dynamic_cast<const AssignStmt*>(s)) return 1 + countNodes(a->index.get()) + countNodes(a->rhs.get());
+    if (auto p = dynamic_cast<const PrintStmt*>(s)) return 1 + countNodes(p->expr.get());
+    if (auto r = dynamic_cast<const ReturnStmt*>(s)) return 1 + countNodes(r->value.get());
+    if (auto c = dynamic_cast<const CallStmt*>(s)) return 1 + countNodes(c->call.get());
+    if (auto i = dynamic_cast<const IfStmt*>(s))
+        return 1 + countNodes(i->cond.get()) + countNodes(i->thenS.get()) + countNodes(i->elseS.get());
+    if (auto w = dynamic_cast<const WhileStmt*>(s)) return 1 + countNodes(w->cond.get()) + countNodes(w->body.get());
+    size_t n = 1;
+    if (auto b = dynamic_cast<const BlockStmt*>(s))
+        for (const auto& x : b->stmts) n += countNodes(x.get());
+    if (auto f = dynamic_cast<const FuncDecl*>(s))
+        for (const auto& x : f->body) n += countNodes(x.get());
+    return n;
+}
+
+// =========================================================
+// MEASUREMENT
+// =========================================================
+struct Sample {
+    double ns;
+    uint64_t allocs, bytes;
+};
+
+// Runs setup() untimed, then body() timed, 'reps' times after two warm-up rounds.
+template <class Setup, class Body>
+static vector<Sample> measure(int reps, Setup setup, Body body) {
+    vector<Sample> out;
+    for (int r = -2; r < reps; r++) {
+        auto state = setup();
+        AllocCount a0 = g_allocCounters.total;
+        auto t0 = chrono::steady_clock::now();
+        auto result = body(state);
+        auto t1 = chrono::steady_clock::now();
+        Sample s{chrono::duration<double, nano>(t1 - t0).count(), g_allocCounters.total.count - a0.count,
+                 g_allocCounters.total.bytes - a0.bytes};
+        if (r >= 0) out.push_back(s);
+        (void)result;   // destroyed outside the timed region
+    }
+    return out;
+}
+
+static double median(vector<double> v) {
+    sort(v.begin(), v.end());
+    size_t n = v.size();
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+struct PhaseResult {
+    string shape, phase;
+    int size;
+    vector<Sample> samples;
+    size_t tokens, nodes, bytes;
+    size_t held;   // footprint of what the phase builds (tokens, AST, symbol table, TAC)
+};
+
+static void printTable(const vector<PhaseResult>& results) {
+    cout << left << setw(14) << "shape" << setw(10) << "phase" << right << setw(12) << "median ms"
+         << setw(9) << "+-MAD%" << setw(11) << "ns/token" << setw(10) << "ns/node" << setw(10) << "MB/s"
+         << setw(12) << "allocs" << setw(14) << "alloc bytes" << setw(14) << "held bytes" << "\n";
+    for (const auto& r : results) {
+        vector<double> ns;
+        for (const auto& s : r.samples) ns.push_back(s.ns);
+        double med = median(ns);
+        vector<double> dev;
+        for (double x : ns) dev.push_back(fabs(x - med));
+        double mad = median(dev);
+        cout << left << setw(14) << r.shape << setw(10) << r.phase << right << fixed
+             << setw(12) << setprecision(3) << med / 1e6
+             << setw(9) << setprecision(1) << (med > 0 ? 100.0 * mad / med : 0.0)
+             << setw(11) << setprecision(1) << med / (double)r.tokens
+             << setw(10) << setprecision(1) << med / (double)r.nodes
+             << setw(10) << setprecision(1) << (double)r.bytes / (med / 1e9) / 1e6
+             << setw(12) << r.samples[0].allocs << setw(14) << r.samples[0].bytes << setw(14) << r.held << "\n";
+    }
+}
+
+static void printJSON(const vector<PhaseResult>& results) {
+    cout << "[\n";
+    for (size_t k = 0; k < results.size(); k++) {
+        const auto& r = results[k];
+        cout << "  {\"shape\": \"" << r.shape << "\", \"phase\": \"" << r.phase << "\", \"tokens\": " << r.tokens
+             << ", \"nodes\": " << r.nodes << ", \"bytes\": " << r.bytes << ", \"allocs\": " << r.samples[0].allocs
+             << ", \"allocBytes\": " << r.samples[0].bytes << ", \"heldBytes\": " << r.held << ", \"ns\": [";
+        for (size_t j = 0; j < r.samples.size(); j++) cout << (j ? ", " : "") << fixed << setprecision(0) << r.samples[j].ns;
+        cout << "]}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    cout << "]\n";
+}
+
+static double medianNs(const PhaseResult& r) {
+    vector<double> ns;
+    for (const auto& s : r.samples) ns.push_back(s.ns);
+    return median(ns);
+}
+
+// Per phase: one row per size with a bar proportional to the time, then the
+// least-squares slope of log(time) over log(tokens).
+static void printScaling(const vector<PhaseResult>& results, bool csv) {
+    if (csv) {
+        cout << "shape,phase,size,bytes,tokens,nodes,median_ns\n";
+        for (const auto& r : results)
+            cout << r.shape << "," << r.phase << "," << r.size << "," << r.bytes << "," << r.tokens << "," << r.nodes << ","
+                 << fixed << setprecision(0) << medianNs(r) << "\n";
+        return;
+    }
+    vector<string> phases;
+    for (const auto& r : results)
+        if (find(phases.begin(), phases.end(), r.phase) == phases.end()) phases.push_back(r.phase);
+    for (const auto& ph : phases) {
+        vector<const PhaseResult*> rows;
+        for (const auto& r : results)
+            if (r.phase == ph) rows.push_back(&r);
+        double most = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        for (auto r : rows) most = max(most, medianNs(*r));
+        cout << ph << " (" << rows[0]->shape << "):\n";
+        for (auto r : rows) {
+            double ns = medianNs(*r);
+            double x = log((double)r->tokens), y = log(max(ns, 1.0));
+            sx += x; sy += y; sxx += x * x; sxy += x * y;
+            cout << "  " << right << setw(8) << r->size << setw(10) << r->tokens << " tok" << fixed << setprecision(3)
+                 << setw(11) << ns / 1e6 << " ms" << setprecision(1) << setw(8) << ns / (double)r->tokens << " ns/tok  "
+                 << string((size_t)(40 * ns / max(most, 1.0) + 0.5), '#') << "\n";
+        }
+        double n = (double)rows.size(), den = n * sxx - sx * sx;
+        if (rows.size() > 1 && den > 0) cout << "  exponent " << setprecision(2) << (n * sxy - sx * sy) / den << "\n";
+        cout << "\n";
+    }
+}
+
+// With 'partial', an input a phase rejects is measured up to and including
+// that phase, timed until its diagnostic (replayed corpus files); otherwise
+// the diagnostic is an error.
+static void benchShape(const string& shape, int size, const string& src, int reps, vector<PhaseResult>& out,
+                       bool partial = false) {
+    vector<Token> tokens;
+    Program ast;
+    SemanticAnalyzer analyzed;
+    int passed = 0;   // phases the input gets through
+    try {
+        tokens = Lexer(src).tokenize();
+        passed = 1;
+        ast = Parser(tokens).parse();
+        passed = 2;
+        analyzed.analyze(ast);
+        passed = 4;   // TAC generation does not reject analyzed programs
+    } catch (const runtime_error&) {
+        if (!partial) throw;
+    }
+    size_t nTokens = max<size_t>(tokens.size(), 1), nNodes = 0;
+    for (const auto& s : ast.stmts) nNodes += countNodes(s.get());
+    nNodes = max<size_t>(nNodes, 1);
+
+    auto add = [&](const char* phase, vector<Sample> samples, size_t held) {
+        out.push_back({shape, phase, size, std::move(samples), nTokens, nNodes, src.size(), held});
+    };
+    // A rejected run yields an empty result instead of throwing.
+    auto guarded = [](auto body) {
+        return [body](auto& state) {
+            try {
+                return body(state);
+            } catch (const runtime_error&) {
+                return decltype(body(state)){};
+            }
+        };
+    };
+    add("lexer", measure(reps, [&] { return 0; }, guarded([&](int) { return Lexer(src).tokenize(); })), footprint(tokens));
+    if (passed < 1) return;
+    add("parser", measure(reps, [&] { return 0; }, guarded([&](int) { return Parser(tokens).parse(); })), footprint(ast));
+    if (passed < 2) return;
+    add("semantic", measure(reps, [&] { return make_unique<SemanticAnalyzer>(); },
+                            guarded([&](unique_ptr<SemanticAnalyzer>& sem) { sem->analyze(ast); return sem->symbols().size(); })),
+        footprint(analyzed.symbols()) + footprint(analyzed.symbolOrder()));
+    if (passed < 4) return;
+    add("tac", measure(reps, [&] { return 0; }, [&](int) { return TACGenerator().generate(ast); }),
+        footprint(TACGenerator().generate(ast)));
+}
+
+// Regular files of a directory, sorted by name.
+static vector<pair<string, string>> readCorpus(const string& dir) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) throw runtime_error("cannot open corpus directory '" + dir + "'");
+    vector<string> names;
+    while (dirent* e = readdir(d))
+        if (e->d_name[0] != '.') names.push_back(e->d_name);
+    closedir(d);
+    sort(names.begin(), names.end());
+    vector<pair<string, string>> files;
+    for (const auto& n : names) {
+        ifstream in(dir + "/" + n, ios::binary);
+        ostringstream o;
+        o << in.rdbuf();
+        files.push_back({n, o.str()});
+    }
+    return files;
+}
+
+int main(int argc, char** argv) {
+    string shape;
+    int size = 20000, reps = 15;
+    bool json = false, scaling = false, csv = false;
+    string corpus;
+    WorkloadParams wp;
+    for (int k = 1; k < argc; k++) {
+        string arg = argv[k];
+        if (arg.rfind("--shape=", 0) == 0) shape = arg.substr(8);
+        else if (arg.rfind("--size=", 0) == 0) size = atoi(arg.c_str() + 7);
+        else if (arg.rfind("--reps=", 0) == 0) reps = atoi(arg.c_str() + 7);
+        else if (arg == "--json") json = true;
+        else if (arg == "--scaling") scaling = true;
+        else if (arg == "--csv") csv = true;
+        else if (arg.rfind("--corpus=", 0) == 0) corpus = arg.substr(9);
+        else if (!applyWorkloadOption(wp, arg)) {
+            cerr << "Unknown option '" << arg << "'\n"
+                 << "usage: bench [--shape=wide|deep|idents|synthetic|all] [--size=N] [--reps=N] [--json]\n"
+                 << "             [--scaling [--csv]] [--corpus=DIR] [workload options, see tools/gen.cpp]\n";
+            return 2;
+        }
+    }
+    if (size < 1 || reps < 1) {
+        cerr << "--size and --reps must be positive\n";
+        return 2;
+    }
+    if (shape.empty()) shape = scaling ? "synthetic" : corpus.empty() ? "all" : "none";
+
+    vector<pair<string, function<string(int)>>> shapes = {
+        {"wide", wideProgram}, {"deep", deepProgram}, {"idents", identsProgram},
+        {"synthetic", [&](int n) { WorkloadParams q = wp; q.stmts = n; return generateWorkload(q); }}};
+    vector<int> sizes{size};
+    if (scaling) sizes = {max(1, size / 16), max(1, size / 8), max(1, size / 4), max(1, size / 2), size};
+
+    vector<PhaseResult> results;
+    try {
+        for (const auto& s : shapes) {
+            if (shape != "all" && shape != s.first) continue;
+            for (int n : sizes) benchShape(s.first, n, s.second(n), reps, results);
+        }
+        if (!corpus.empty())
+            for (const auto& f : readCorpus(corpus)) benchShape(f.first, 0, f.second, reps, results, true);
+    } catch (const exception& ex) {
+        cerr << ex.what() << "\n";
+        return 1;
+    }
+    if (results.empty()) {
+        if (!corpus.empty()) cerr << "Nothing to replay in '" << corpus << "'\n";
+        else cerr << "Unknown shape '" << shape << "'\n";
+        return 2;
+    }
+    if (scaling) printScaling(results, csv);
+    else if (json) printJSON(results);
+    else printTable(results);
+    return 0;
+}
@@ -0,0 +1,300 @@
+// fuzz.cpp - fuzzing harness for the front end that also flags slow inputs
+// Runs Lexer -> Parser -> SemanticAnalyzer -> TACGenerator on each input.
+// Diagnostics (runtime_error) are the expected outcome for most inputs; any
+// other exception or signal is a bug. An input is "slow" when both hold:
+//   - it takes longer than MINI_FUZZ_MIN_NS;
+//   - its time per input byte exceeds MINI_FUZZ_NS_PER_BYTE, or the memory
+//     the built structures hold (tokens, AST, symbol table, TAC; see 4c in
+//     the compiler) per input byte exceeds MINI_FUZZ_HELD_PER_BYTE.
+// Slow inputs are saved as <dir>/slow-<hash> in MINI_FUZZ_SLOW_DIR (default
+// tools/slow-corpus), which bench --corpus replays; crash reproducers as
+// crash-<hash>. Both are relative to --artifact-dir (MINI_FUZZ_ARTIFACT_DIR,
+// default the current directory), so point it at the repo root when running
+// from elsewhere.
+//
+// libFuzzer:  clang++ -std=c++17 -O2 -g -fsanitize=fuzzer,address -DMINI_FUZZ_LIBFUZZER -o fuzz tools/fuzz.cpp
+//             ./fuzz -max_len=65536 CORPUS_DIR
+// Standalone: g++ -std=c++17 -O2 -o fuzz tools/fuzz.cpp
+//             fuzz < input                     one input from stdin (AFL style)
+//             fuzz FILE|DIR...                 replay files
+//             fuzz --mutate=N [--seed=S] [--max-len=N] [--artifact-dir=DIR] [FILE|DIR...]
+//                                              N mutations of built-in seeds and the given files
+#define MINI_COMPILER_NO_MAIN
+#define MINI_COUNT_ALLOCS
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"   // driver helpers the harness does not call
+#include "../bin/compiler.cpp"
+#pragma GCC diagnostic pop
+
+#include "workload.h"
+
+#include <cstdio>
+#include <dirent.h>
+#include <fstream>
+#include <sys/stat.h>
+
+// =========================================================
+// THRESHOLDS AND THE SLOW CORPUS
+// =========================================================
+struct FuzzLimits {
+    double minNs = 1e6;             // ignore anything faster than 1 ms
+    double nsPerByte = 10000;       // about 10x a typical program
+    double heldPerByte = 8192;      // bytes held by the built structures per input byte
+    string slowDir = "tools/slow-corpus";
+    string artifactDir = ".";       // base of slowDir (when relative) and crash reproducers
+};
+
+static double envNumber(const char* name, double fallback) {
+    const char* v = getenv(name);
+    return v && *v ? atof(v) : fallback;
+}
+
+static FuzzLimits& limits() {
+    static FuzzLimits l = [] {
+        FuzzLimits x;
+        x.minNs = envNumber("MINI_FUZZ_MIN_NS", x.minNs);
+        x.nsPerByte = envNumber("MINI_FUZZ_NS_PER_BYTE", x.nsPerByte);
+        x.heldPerByte = envNumber("MINI_FUZZ_HELD_PER_BYTE", x.heldPerByte);
+        if (const char* d = getenv("MINI_FUZZ_SLOW_DIR")) x.slowDir = d;
+        if (const char* d = getenv("MINI_FUZZ_ARTIFACT_DIR"); d && *d) x.artifactDir = d;
+        return x;
+    }();
+    return l;
+}
+
+// FNV-1a, so the same input always gets the same file name.
+static string inputHash(const string& s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : s) h = (h ^ c) * 16777619u;
+    ostringstream o;
+    o << hex << setw(8) << setfill('0') << h;
+    return o.str();
+}
+
+// A path under the artifact directory; absolute paths are kept as they are.
+static string artifactPath(const string& p) {
+    const string& base = limits().artifactDir;
+    if (p.empty() || p[0] == '/' || base == ".") return p.empty() ? base : p;
+    return base + "/" + p;
+}
+
+static string saveInput(const string& dir, const string& prefix, const string& input) {
+    for (size_t k = dir.find('/', 1); k != string::npos; k = dir.find('/', k + 1))
+        mkdir(dir.substr(0, k).c_str(), 0755);   // parents first; existing ones are fine
+    mkdir(dir.c_str(), 0755);
+    string path = dir + "/" + prefix + inputHash(input);
+    ofstream(path, ios::binary) << input;
+    return path;
+}
+
+// =========================================================
+// ONE INPUT
+// =========================================================
+struct RunResult {
+    double ns = 0;
+    size_t held = 0;
+    uint64_t allocBytes = 0;
+    string stage;   // last phase reached: lex, parse, semantic, tac or done
+};
+
+static RunResult runPipeline(const string& src) {
+    RunResult r;
+    uint64_t alloc0 = g_allocCounters.total.bytes;
+    auto t0 = chrono::steady_clock::now();
+    vector<Token> tokens;
+    Program ast;
+    SemanticAnalyzer sem;
+    TACProgram tac;
+    try {
+        r.stage = "lex";
+        tokens = Lexer(src).tokenize();
+        r.stage = "parse";
+        ast = Parser(tokens).parse();
+        r.stage = "semantic";
+        sem.analyze(ast);
+        r.stage = "tac";
+        tac = TACGenerator().generate(ast);
+        r.stage = "done";
+    } catch (const runtime_error&) {
+        // a diagnostic: the input is rejected, which is fine
+    }
+    r.ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+    r.allocBytes = g_allocCounters.total.bytes - alloc0;
+    r.held = footprint(tokens) + footprint(ast) + footprint(sem.symbols()) + footprint(sem.symbolOrder()) + footprint(tac);
+    return r;
+}
+
+// Runs one input and saves it if it is slow; true when it was.
+static bool checkInput(const string& src) {
+    const FuzzLimits& l = limits();
+    RunResult r = runPipeline(src);
+    double bytes = (double)max<size_t>(src.size(), 1);
+    bool slowTime = r.ns >= l.minNs && r.ns / bytes > l.nsPerByte;
+    bool bigHeld = r.ns >= l.minNs && (double)r.held / bytes > l.heldPerByte;
+    if (!slowTime && !bigHeld) return false;
+    string path = saveInput(artifactPath(l.slowDir), "slow-", src);
+    cerr << "SLOW " << (slowTime ? "time" : "memory") << " size=" << src.size() << " stage=" << r.stage << " ms=" << fixed
+         << setprecision(3) << r.ns / 1e6 << " ns/byte=" << setprecision(0) << r.ns / bytes
+         << " held/byte=" << (double)r.held / bytes << " alloc/byte=" << (double)r.allocBytes / bytes << " -> " << path
+         << "\n";
+    return true;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    checkInput(string((const char*)data, size));
+    return 0;
+}
+
+#ifndef MINI_FUZZ_LIBFUZZER
+// =========================================================
+// STANDALONE DRIVER (replay, stdin, built-in mutator)
+// =========================================================
+class Mutator {
+    uint64_t state;
+    size_t maxLen;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    size_t below(size_t n) { return n <= 1 ? 0 : (size_t)(next() % n); }
+
+    string token() {
+        static const char* dict[] = {"int ", "print ", "if ", "else ", "while ", "return ", "(", ")", "{", "}",
+                                     "[", "]", "+", "-", "*", "/", "=", "==", "<", "<=", ";", ",", "x", "y",
+                                     "f(", "a[0]", "0", "1", "2147483647", "// c\n", "\n", " "};
+        return dict[below(sizeof dict / sizeof dict[0])];
+    }
+
+public:
+    Mutator(uint64_t seed, size_t maxBytes) : state(seed), maxLen(maxBytes) {}
+
+    string mutate(string s, const vector<string>& pool) {
+        size_t pos = below(s.size() + 1);
+        switch (below(8)) {
+            case 0: if (!s.empty()) s[below(s.size())] = token()[0]; break;
+            case 1: s.insert(pos, token()); break;
+            case 2: if (!s.empty()) s.erase(pos == s.size() ? pos - 1 : pos, 1 + below(16)); break;
+            case 3: {   // repeat a slice
+                size_t len = 1 + below(min<size_t>(s.size() - min(pos, s.size()), 64) + 1);
+                string piece = s.substr(pos, len);
+                for (size_t k = 1 + below(8); k > 0; k--) s.insert(pos, piece);
+                break;
+            }
+            case 4: {   // deep nesting
+                size_t depth = 1 + below(256);
+                s.insert(pos, "print " + string(depth, '(') + "1" + string(depth, ')') + ";\n");
+                break;
+            }
+            case 5: s.insert(pos, string(1 + below(4096), (char)('0' + below(10)))); break;   // huge literal
+            case 6: {   // long chain of one operator
+                string chain = "print 1";
+                for (size_t k = 1 + below(512); k > 0; k--) chain += " + 1";
+                s.insert(pos, chain + ";\n");
+                break;
+            }
+            default: {   // splice with another input
+                const string& other = pool[below(pool.size())];
+                size_t from = below(other.size() + 1);
+                s = s.substr(0, pos) + other.substr(from, below(other.size() - from + 1));
+                break;
+            }
+        }
+        if (s.size() > maxLen) s.resize(maxLen);
+        return s;
+    }
+};
+
+static void collectFiles(const string& path, vector<string>& files) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) throw runtime_error("cannot open '" + path + "'");
+    if (!S_ISDIR(st.st_mode)) {
+        files.push_back(path);
+        return;
+    }
+    DIR* d = opendir(path.c_str());
+    if (!d) throw runtime_error("cannot open '" + path + "'");
+    vector<string> names;
+    while (dirent* e = readdir(d))
+        if (e->d_name[0] != '.') names.push_back(e->d_name);
+    closedir(d);
+    sort(names.begin(), names.end());
+    for (const auto& n : names) collectFiles(path + "/" + n, files);
+}
+
+static string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    ostringstream o;
+    o << in.rdbuf();
+    return o.str();
+}
+
+int main(int argc, char** argv) {
+    long long mutations = -1;
+    uint64_t seed = 1;
+    size_t maxLen = 65536;
+    vector<string> files;
+    try {
+        for (int k = 1; k < argc; k++) {
+            string arg = argv[k];
+            if (arg.rfind("--mutate=", 0) == 0) mutations = atoll(arg.c_str() + 9);
+            else if (arg.rfind("--seed=", 0) == 0) seed = strtoull(arg.c_str() + 7, nullptr, 10);
+            else if (arg.rfind("--max-len=", 0) == 0) maxLen = (size_t)max(1LL, atoll(arg.c_str() + 10));
+            else if (arg.rfind("--artifact-dir=", 0) == 0 && arg.size() > 15) limits().artifactDir = arg.substr(15);
+            else if (arg.rfind("--", 0) == 0) {
+                cerr << "Unknown option '" << arg << "'\n"
+                     << "usage: fuzz [--mutate=N [--seed=S] [--max-len=N]] [--artifact-dir=DIR] [FILE|DIR...]"
+                     << "   (no arguments: one input from stdin)\n";
+                return 2;
+            }
+            else collectFiles(arg, files);
+        }
+    } catch (const exception& ex) {
+        cerr << ex.what() << "\n";
+        return 2;
+    }
+
+    if (mutations < 0 && files.empty()) {   // AFL style: the input on stdin
+        ostringstream o;
+        o << cin.rdbuf();
+        return checkInput(o.str()) ? 3 : 0;
+    }
+
+    vector<string> pool;
+    for (const auto& f : files) pool.push_back(readFile(f));
+    if (mutations < 0) {
+        int slow = 0;
+        for (size_t k = 0; k < pool.size(); k++) slow += checkInput(pool[k]);
+        cerr << pool.size() << " input(s) replayed, " << slow << " slow\n";
+        return 0;
+    }
+
+    for (int k = 0; k < 4; k++) {
+        WorkloadParams p;
+        p.seed = seed + (uint64_t)k;
+        p.decls = 8;
+        p.stmts = 20 << k;
+        pool.push_back(generateWorkload(p));
+    }
+    pool.push_back("int f(int a) { return a * 2; }\nint x[4];\nint y;\ny = f(3);\nx[1] = y;\nprint x[1];\n");
+
+    Mutator mut(seed, maxLen);
+    int slow = 0;
+    string current;
+    for (long long n = 0; n < mutations; n++) {
+        if (n % 16 == 0) current = pool[(size_t)(n / 16) % pool.size()];
+        current = mut.mutate(current, pool);
+        try {
+            slow += checkInput(current);
+        } catch (const exception& ex) {   // not a diagnostic: a bug in the compiler
+            string path = saveInput(artifactPath(""), "crash-", current);
+            cerr << "CRASH " << ex.what() << " -> " << path << "\n";
+            return 1;
+        }
+    }
+    cerr << mutations << " mutation(s), " << slow << " slow input(s) saved to " << artifactPath(limits().slowDir) << "\n";
+    return 0;
+}
+#endif
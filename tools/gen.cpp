@@ -0,0 +1,26 @@
+// gen.cpp - prints a synthetic program for the mini compiler (see workload.h)
+// Build:  g++ -std=c++17 -O2 -o gen tools/gen.cpp
+// Usage:  gen [--seed=N] [--decls=N] [--stmts=N] [--depth=N] [--width=N] [--ident-len=N]
+//             [--const-density=P] [--comment-ratio=P] [--repeat=P] [--control=P]
+// Probabilities P are in [0, 1]. Same options and seed, same program.
+#include "workload.h"
+
+#include <iostream>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    WorkloadParams p;
+    for (int k = 1; k < argc; k++) {
+        if (!applyWorkloadOption(p, argv[k])) {
+            cerr << "Unknown option '" << argv[k] << "'\n";
+            return 2;
+        }
+    }
+    if (p.decls < 0 || p.stmts < 0 || p.depth < 0) {
+        cerr << "--decls, --stmts and --depth must not be negative\n";
+        return 2;
+    }
+    cout << generateWorkload(p);
+    return 0;
+}
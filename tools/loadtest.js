@@ -0,0 +1,353 @@
+// loadtest.js - end-to-end HTTP load generator for server.js
+// Drives POST /api/compile with a closed loop of concurrent clients for a
+// fixed duration and reports throughput and latency percentiles. Uses only
+// Node built-ins. Without --url it starts server.js itself on a free port, so
+// server configurations (COMPILE_MODE spawn / pool / cache) can be compared
+// side by side with --compare.
+//
+//   node tools/loadtest.js --compiler=/path/to/compiler [options]
+//
+//   --url=http://host:port     test a running server instead of starting one
+//   --compiler=PATH            COMPILER_PATH for the started server
+//   --mode=spawn|pool|cache    COMPILE_MODE for the started server (default spawn)
+//   --compare=spawn,pool,cache run each mode in turn and print them side by side
+//   --pool-size=N              POOL_SIZE for the started server
+//   --concurrency=N            clients with one request in flight each (default 16)
+//   --duration=S               measured seconds per run (default 10)
+//   --warmup=S                 unmeasured seconds before that (default 2)
+//   --mix=sample:70,large:20,error:10
+//                              request mix by weight
+//   --large-stmts=N            statements per large program (default 2000)
+//   --variants=N               distinct programs per kind (default 16)
+//   --opt-level=N              optLevel sent with every request
+//   --format=full|compact      response format sent with every request (default full)
+//   --encoding=br|gzip         Accept-Encoding sent; responses are decompressed (default none)
+//   --seed=N                   request order / program seed (default 1)
+//   --json                     machine-readable output
+//   --samples                  with --json, include every measured latency (ms)
+"use strict";
+
+const http = require("node:http");
+const zlib = require("node:zlib");
+const net = require("node:net");
+const path = require("node:path");
+const { spawn } = require("node:child_process");
+
+function parseArgs(argv) {
+  const o = {
+    url: "",
+    compiler: "",
+    mode: "spawn",
+    compare: [],
+    poolSize: 0,
+    concurrency: 16,
+    duration: 10,
+    warmup: 2,
+    mix: { sample: 70, large: 20, error: 10 },
+    largeStmts: 2000,
+    variants: 16,
+    optLevel: null,
+    format: "",
+    encoding: "",
+    seed: 1,
+    json: false,
+    samples: false,
+  };
+  for (const arg of argv) {
+    const m = /^--([a-z-]+)(?:=(.*))?$/.exec(arg);
+    if (!m) throw new Error(`unknown argument: ${arg}`);
+    const [, name, v = ""] = m;
+    if (name === "url") o.url = v.replace(/\/$/, "");
+    else if (name === "compiler") o.compiler = path.resolve(v);
+    else if (name === "mode") o.mode = v;
+    else if (name === "compare") o.compare = v.split(",").filter(Boolean);
+    else if (name === "pool-size") o.poolSize = Number(v);
+    else if (name === "concurrency") o.concurrency = Math.max(1, Number(v));
+    else if (name === "duration") o.duration = Number(v);
+    else if (name === "warmup") o.warmup = Number(v);
+    else if (name === "large-stmts") o.largeStmts = Number(v);
+    else if (name === "variants") o.variants = Math.max(1, Number(v));
+    else if (name === "opt-level") o.optLevel = Number(v);
+    else if (name === "format") o.format = v;
+    else if (name === "encoding") o.encoding = v;
+    else if (name === "seed") o.seed = Number(v);
+    else if (name === "json") o.json = true;
+    else if (name === "samples") o.samples = true;
+    else if (name === "mix") {
+      o.mix = {};
+      for (const part of v.split(",")) {
+        const [kind, weight] = part.split(":");
+        if (!["sample", "large", "error"].includes(kind)) throw new Error(`unknown request kind in --mix: ${kind}`);
+        o.mix[kind] = Number(weight);
+      }
+    } else throw new Error(`unknown option: --${name}`);
+  }
+  if (o.url && o.compare.length > 0) throw new Error("--compare starts its own servers; drop --url");
+  return o;
+}
+
+// Small deterministic PRNG so a seed gives the same programs and request order.
+function rng(seed) {
+  let s = seed >>> 0 || 1;
+  return () => {
+    s ^= s << 13;
+    s ^= s >>> 17;
+    s ^= s << 5;
+    return (s >>> 0) / 4294967296;
+  };
+}
+
+const SAMPLE = "int a;\nint b;\n\na = 5;\nb = a + 10 * (2 - 1);\nprint b;\n";
+
+function largeProgram(stmts, seed) {
+  const rand = rng(seed);
+  const vars = [];
+  for (let k = 0; k < 32; k++) vars.push(`v${k}`);
+  let src = vars.map((v) => `int ${v};\n`).join("") + "int i;\n";
+  src += vars.map((v, k) => `${v} = ${k + seed};\n`).join("");
+  const leaf = () => (rand() < 0.3 ? String(Math.floor(rand() * 100)) : vars[Math.floor(rand() * vars.length)]);
+  const expr = (d) => {
+    if (d > 2 || rand() < 0.3) return leaf();
+    const op = "+-*"[Math.floor(rand() * 3)];
+    return `(${expr(d + 1)} ${op} ${expr(d + 1)})`;
+  };
+  for (let k = 0; k < stmts; k++) {
+    const r = rand();
+    if (r < 0.05) src += `i = 0;\nwhile (i < 4) {\n    ${vars[k % 32]} = ${expr(1)};\n    i = i + 1;\n}\n`;
+    else if (r < 0.1) src += `if (${expr(1)} < ${expr(1)}) {\n    print ${expr(1)};\n} else {\n    ${vars[k % 32]} = ${expr(1)};\n}\n`;
+    else src += `${vars[Math.floor(rand() * vars.length)]} = ${expr(0)};\n`;
+  }
+  return src + "print v0;\n";
+}
+
+// Lexical, syntax and semantic errors, each reached after some valid code.
+function errorProgram(k) {
+  const prefix = `int a;\nint b;\na = ${k};\n`;
+  const faults = [
+    "b = a + ;\n",
+    "b = (a * 2;\n",
+    "print c;\n",
+    "int a;\n",
+    "b = a $ 2;\n",
+    "while (a < 3 {\n    a = a + 1;\n}\n",
+    "b = a / 0;\nprint b;\n",
+    "if (a) { print a;\n",
+  ];
+  return prefix + faults[k % faults.length];
+}
+
+function buildPrograms(o) {
+  const programs = { sample: [SAMPLE], large: [], error: [] };
+  for (let k = 0; k < o.variants; k++) {
+    programs.large.push(largeProgram(o.largeStmts, o.seed * 1000 + k + 1));
+    programs.error.push(errorProgram(k));
+  }
+  return programs;
+}
+
+function freePort() {
+  return new Promise((resolve, reject) => {
+    const srv = net.createServer();
+    srv.on("error", reject);
+    srv.listen(0, "127.0.0.1", () => {
+      const { port } = srv.address();
+      srv.close(() => resolve(port));
+    });
+  });
+}
+
+function request(agent, url, method, body, encoding = "") {
+  return new Promise((resolve) => {
+    const headers = body ? { "Content-Type": "application/json" } : {};
+    if (encoding) headers["Accept-Encoding"] = encoding;
+    const req = http.request(url, { method, agent, headers }, (res) => {
+      const contentEncoding = res.headers["content-encoding"];
+      let stream = res;
+      if (contentEncoding === "br") stream = res.pipe(zlib.createBrotliDecompress());
+      else if (contentEncoding === "gzip") stream = res.pipe(zlib.createGunzip());
+      let data = "";
+      stream.setEncoding("utf8");
+      stream.on("data", (chunk) => {
+        data += chunk;
+      });
+      stream.on("end", () => resolve({ status: res.statusCode, body: data }));
+      stream.on("error", (err) => resolve({ status: 0, body: String(err) }));
+    });
+    req.on("error", (err) => resolve({ status: 0, body: String(err) }));
+    req.end(body);
+  });
+}
+
+async function startServer(o, mode) {
+  const port = await freePort();
+  const env = { ...process.env, PORT: String(port), COMPILE_MODE: mode };
+  if (o.compiler) env.COMPILER_PATH = o.compiler;
+  if (o.poolSize > 0) env.POOL_SIZE = String(o.poolSize);
+  const child = spawn(process.execPath, [path.join(__dirname, "..", "server.js")], { env, stdio: ["ignore", "ignore", "pipe"] });
+  let stderr = "";
+  child.stderr.on("data", (chunk) => {
+    stderr += chunk;
+  });
+
+  const url = `http://127.0.0.1:${port}`;
+  for (let tries = 0; tries < 100; tries++) {
+    if (child.exitCode !== null) throw new Error(`server exited during startup:\n${stderr}`);
+    const res = await request(undefined, `${url}/`, "GET");
+    if (res.status === 200) return { url, stop: () => child.kill() };
+    await new Promise((r) => setTimeout(r, 100));
+  }
+  child.kill();
+  throw new Error(`server did not start on port ${port}:\n${stderr}`);
+}
+
+function percentile(sorted, q) {
+  if (sorted.length === 0) return 0;
+  const rank = Math.ceil(q * sorted.length);
+  return sorted[Math.min(sorted.length, Math.max(1, rank)) - 1];
+}
+
+function summarize(latencies) {
+  const sorted = Float64Array.from(latencies).sort();
+  return {
+    count: sorted.length,
+    p50: percentile(sorted, 0.5),
+    p95: percentile(sorted, 0.95),
+    p99: percentile(sorted, 0.99),
+    p999: percentile(sorted, 0.999),
+    max: sorted.length ? sorted[sorted.length - 1] : 0,
+  };
+}
+
+// Closed loop: each client sends its next request as soon as the last one answers.
+async function drive(o, url, programs) {
+  const kinds = Object.keys(o.mix).filter((k) => o.mix[k] > 0);
+  const total = kinds.reduce((s, k) => s + o.mix[k], 0);
+  if (total <= 0) throw new Error("--mix has no positive weights");
+  const agent = new http.Agent({ keepAlive: true, maxSockets: o.concurrency });
+  const rand = rng(o.seed);
+  const pick = () => {
+    let r = rand() * total;
+    for (const k of kinds) {
+      if ((r -= o.mix[k]) < 0) return k;
+    }
+    return kinds[kinds.length - 1];
+  };
+
+  const latencies = [];
+  const byKind = {};
+  const outcomes = { ok: 0, compileError: 0, httpError: 0, networkError: 0 };
+  for (const k of kinds) byKind[k] = [];
+
+  const start = Date.now();
+  const measureFrom = start + o.warmup * 1000;
+  const stopAt = measureFrom + o.duration * 1000;
+
+  async function client() {
+    while (Date.now() < stopAt) {
+      const kind = pick();
+      const list = programs[kind];
+      const payload = { code: list[Math.floor(rand() * list.length)] };
+      if (o.optLevel !== null) payload.optLevel = o.optLevel;
+      if (o.format) payload.format = o.format;
+
+      const t0 = process.hrtime.bigint();
+      const res = await request(agent, `${url}/api/compile`, "POST", JSON.stringify(payload), o.encoding);
+      const ms = Number(process.hrtime.bigint() - t0) / 1e6;
+      if (Date.now() < measureFrom) continue;
+
+      let outcome;
+      if (res.status === 0) outcome = "networkError";
+      else if (res.status !== 200) outcome = "httpError";
+      else {
+        try {
+          outcome = JSON.parse(res.body).ok ? "ok" : "compileError";
+        } catch {
+          outcome = "httpError";
+        }
+      }
+      outcomes[outcome]++;
+      latencies.push(ms);
+      byKind[kind].push(ms);
+    }
+  }
+
+  await Promise.all(Array.from({ length: o.concurrency }, client));
+  agent.destroy();
+  const seconds = (Date.now() - measureFrom) / 1000;
+
+  const kindStats = {};
+  for (const k of kinds) kindStats[k] = summarize(byKind[k]);
+  const result = {
+    seconds,
+    throughput: latencies.length / seconds,
+    latency: summarize(latencies),
+    outcomes,
+    kinds: kindStats,
+  };
+  if (o.samples) result.samples = latencies.map((ms) => Math.round(ms * 1000) / 1000);
+  return result;
+}
+
+function fmt(ms) {
+  return ms >= 100 ? ms.toFixed(0) : ms >= 10 ? ms.toFixed(1) : ms.toFixed(2);
+}
+
+function printRuns(o, runs) {
+  const names = Object.keys(runs);
+  const rows = [
+    ["requests", (r) => String(r.latency.count)],
+    ["req/s", (r) => r.throughput.toFixed(1)],
+    ["p50 ms", (r) => fmt(r.latency.p50)],
+    ["p95 ms", (r) => fmt(r.latency.p95)],
+    ["p99 ms", (r) => fmt(r.latency.p99)],
+    ["p999 ms", (r) => fmt(r.latency.p999)],
+    ["max ms", (r) => fmt(r.latency.max)],
+    ["ok", (r) => String(r.outcomes.ok)],
+    ["compile error", (r) => String(r.outcomes.compileError)],
+    ["http error", (r) => String(r.outcomes.httpError)],
+    ["network error", (r) => String(r.outcomes.networkError)],
+  ];
+  for (const k of Object.keys(o.mix).filter((k) => o.mix[k] > 0)) {
+    rows.push([`${k} p50 ms`, (r) => fmt(r.kinds[k].p50)]);
+    rows.push([`${k} p99 ms`, (r) => fmt(r.kinds[k].p99)]);
+  }
+
+  const mix = Object.entries(o.mix).map(([k, w]) => `${k}:${w}`).join(",");
+  console.log(`concurrency ${o.concurrency}, ${o.duration}s measured after ${o.warmup}s warmup, mix ${mix}`);
+  console.log("");
+  let header = "".padEnd(16);
+  for (const n of names) header += n.padStart(12);
+  console.log(header);
+  for (const [label, get] of rows) {
+    let line = label.padEnd(16);
+    for (const n of names) line += get(runs[n]).padStart(12);
+    console.log(line);
+  }
+}
+
+async function main() {
+  const o = parseArgs(process.argv.slice(2));
+  const programs = buildPrograms(o);
+  const runs = {};
+
+  if (o.url) {
+    runs[o.url] = await drive(o, o.url, programs);
+  } else {
+    for (const mode of o.compare.length > 0 ? o.compare : [o.mode]) {
+      const server = await startServer(o, mode);
+      try {
+        runs[mode] = await drive(o, server.url, programs);
+      } finally {
+        server.stop();
+      }
+    }
+  }
+
+  if (o.json) console.log(JSON.stringify({ concurrency: o.concurrency, duration: o.duration, mix: o.mix, runs }, null, 2));
+  else printRuns(o, runs);
+}
+
+main().catch((err) => {
+  console.error(err.message);
+  process.exit(1);
+});
@@ -0,0 +1,184 @@
+// test.js - regression tests for the compiler (npm test)
+// Every case in tools/tests/*.mc is compiled and run (--run) at -O0, -O1 and
+// -O2; the program output must match the case's "// expect:" lines at every
+// level. A case whose compile must fail gives "// expect-error: TEXT" instead,
+// and TEXT must appear in the compiler's stderr.
+// Then, differentially: programs from tools/gen.cpp with fixed seeds (see
+// DIFF_PROFILES) must print the same at -O1 and -O2 as at -O0, with the
+// passes one at a time on top of -O0 as well.
+//
+//   node tools/test.js [--compiler=PATH] [--gen=PATH] [--seeds=N] [CASE...]
+//
+//   --compiler=PATH   compiler binary (default COMPILER_PATH, then bin/compiler)
+//   --gen=PATH        program generator (default: tools/gen.cpp built with $CXX or g++)
+//   --seeds=N         generated programs per profile (default 4; 0 skips them)
+//   CASE              only the cases whose file name contains CASE; no generated programs
+"use strict";
+
+const fs = require("node:fs");
+const os = require("node:os");
+const path = require("node:path");
+const { spawnSync } = require("node:child_process");
+
+const ROOT = path.join(__dirname, "..");
+const CASES_DIR = path.join(__dirname, "tests");
+const LEVELS = ["-O0", "-O1", "-O2"];
+
+// Generator options for the differential run; seeds 1..--seeds of each.
+const DIFF_PROFILES = [
+  { name: "straight", args: ["--stmts=200", "--control=0"] },
+  { name: "control", args: ["--stmts=150", "--control=0.4", "--depth=3"] },
+  { name: "constants", args: ["--stmts=150", "--const-density=0.7", "--control=0.2"] },
+  { name: "short-names", args: ["--stmts=150", "--decls=16", "--ident-len=1", "--control=0.2"] },
+  { name: "chains", args: ["--stmts=60", "--depth=2", "--width=40", "--control=0.2"] },
+];
+// Each pass alone on top of -O0, so a wrong pass is named even when -O2 hides it.
+const SINGLE_PASSES = ["constprop", "dce", "reassoc", "sccp", "gvn", "ssa-dce", "licm", "iv-sr", "bce", "inline", "slp"];
+
+function parseArgs(argv) {
+  const o = {
+    compiler: process.env.COMPILER_PATH || path.join(ROOT, "bin", process.platform === "win32" ? "compiler.exe" : "compiler"),
+    gen: "",
+    seeds: 4,
+    filters: [],
+  };
+  for (const arg of argv) {
+    if (arg.startsWith("--compiler=")) o.compiler = path.resolve(arg.slice(11));
+    else if (arg.startsWith("--gen=")) o.gen = path.resolve(arg.slice(6));
+    else if (arg.startsWith("--seeds=")) o.seeds = Math.max(0, Number(arg.slice(8)) || 0);
+    else if (arg.startsWith("--")) throw new Error(`Unknown option '${arg}'`);
+    else o.filters.push(arg);
+  }
+  return o;
+}
+
+// Runs the compiler on source; returns {status, stdout, stderr}.
+function compile(compiler, source, args) {
+  const r = spawnSync(compiler, args, { input: source, encoding: "utf8", maxBuffer: 256 * 1024 * 1024 });
+  if (r.error) throw new Error(`cannot run ${compiler}: ${r.error.message}`);
+  return r;
+}
+
+// The lines the program printed (everything after "PROGRAM OUTPUT:").
+function programOutput(stdout) {
+  const at = stdout.indexOf("PROGRAM OUTPUT:\n");
+  if (at === -1) return null;
+  return stdout
+    .slice(at + "PROGRAM OUTPUT:\n".length)
+    .split("\n")
+    .filter((line) => line !== "");
+}
+
+function loadCase(file) {
+  const source = fs.readFileSync(file, "utf8");
+  const expect = [];
+  let expectError = null;
+  for (const line of source.split("\n")) {
+    const m = /^\s*\/\/\s*expect(-error)?:\s?(.*)$/.exec(line);
+    if (!m) continue;
+    if (m[1]) expectError = m[2].trim();
+    else expect.push(m[2].trim());
+  }
+  return { name: path.basename(file, ".mc"), source, expect, expectError };
+}
+
+// Problems with one case at one level; empty when it passed.
+function checkCase(compiler, c, level) {
+  const r = compile(compiler, c.source, [level, "--run"]);
+  if (c.expectError !== null) {
+    if (r.status === 0) return [`compiled, expected an error containing '${c.expectError}'`];
+    if (!r.stderr.includes(c.expectError)) return [`expected an error containing '${c.expectError}', got: ${r.stderr.trim()}`];
+    return [];
+  }
+  if (r.status !== 0) return [`exit code ${r.status}: ${r.stderr.trim()}`];
+  const got = programOutput(r.stdout);
+  if (got === null) return ["no PROGRAM OUTPUT section"];
+  if (got.join("\n") !== c.expect.join("\n")) return [`printed [${got.join(", ")}], expected [${c.expect.join(", ")}]`];
+  return [];
+}
+
+// tools/gen.cpp built into a temporary directory.
+function buildGen() {
+  const dir = fs.mkdtempSync(path.join(os.tmpdir(), "mini-test-"));
+  const exe = path.join(dir, process.platform === "win32" ? "gen.exe" : "gen");
+  const cxx = process.env.CXX || "g++";
+  const r = spawnSync(cxx, ["-std=c++17", "-O2", "-o", exe, path.join(__dirname, "gen.cpp")], { encoding: "utf8" });
+  if (r.error || r.status !== 0) throw new Error(`cannot build tools/gen.cpp with ${cxx}: ${r.error ? r.error.message : r.stderr}`);
+  return exe;
+}
+
+// What the program printed with these options, or the failure.
+function runOutput(compiler, source, args) {
+  const r = compile(compiler, source, [...args, "--run"]);
+  if (r.status !== 0) return `exit code ${r.status}: ${r.stderr.trim()}`;
+  const out = programOutput(r.stdout);
+  return out === null ? "no PROGRAM OUTPUT section" : out.join("\n");
+}
+
+// Failures of the generated programs, as "profile seed N: problem" lines.
+function differential(o) {
+  const gen = o.gen || buildGen();
+  try {
+    return compareLevels(o, gen);
+  } finally {
+    if (!o.gen) fs.rmSync(path.dirname(gen), { recursive: true, force: true });
+  }
+}
+
+function compareLevels(o, gen) {
+  const variants = [["-O1"], ["-O2"], ...SINGLE_PASSES.map((pass) => ["-O0", `--enable-pass=${pass}`])];
+  const failures = [];
+  for (const profile of DIFF_PROFILES) {
+    for (let seed = 1; seed <= o.seeds; seed++) {
+      const g = spawnSync(gen, [`--seed=${seed}`, ...profile.args], { encoding: "utf8", maxBuffer: 64 * 1024 * 1024 });
+      if (g.error || g.status !== 0) throw new Error(`${gen} failed: ${g.error ? g.error.message : g.stderr}`);
+      const reference = runOutput(o.compiler, g.stdout, ["-O0"]);
+      if (reference.startsWith("exit code")) {
+        failures.push(`${profile.name} seed ${seed}: -O0 ${reference}`);
+        continue;
+      }
+      for (const args of variants) {
+        if (runOutput(o.compiler, g.stdout, args) === reference) continue;
+        failures.push(`${profile.name} seed ${seed}: ${args.join(" ")} prints differently from -O0 (gen --seed=${seed} ${profile.args.join(" ")})`);
+        break;
+      }
+    }
+  }
+  return { count: DIFF_PROFILES.length * o.seeds, failures };
+}
+
+function main() {
+  const o = parseArgs(process.argv.slice(2));
+  if (!fs.existsSync(o.compiler)) throw new Error(`compiler not found at: ${o.compiler} (run \`npm run build:compiler\`)`);
+
+  const files = fs
+    .readdirSync(CASES_DIR)
+    .filter((f) => f.endsWith(".mc") && (o.filters.length === 0 || o.filters.some((s) => f.includes(s))))
+    .sort();
+  let failed = 0;
+  for (const f of files) {
+    const c = loadCase(path.join(CASES_DIR, f));
+    const problems = [];
+    for (const level of LEVELS) for (const p of checkCase(o.compiler, c, level)) problems.push(`${level}: ${p}`);
+    if (problems.length === 0) continue;
+    failed++;
+    console.log(`FAIL ${c.name}`);
+    for (const p of problems) console.log(`  ${p}`);
+  }
+  console.log(`${files.length - failed}/${files.length} case(s) passed`);
+
+  if (o.filters.length === 0 && o.seeds > 0) {
+    const diff = differential(o);
+    for (const f of diff.failures) console.log(`FAIL ${f}`);
+    console.log(`${diff.count - diff.failures.length}/${diff.count} generated program(s) agree across -O levels and passes`);
+    if (diff.failures.length > 0) failed++;
+  }
+  return failed === 0 ? 0 : 1;
+}
+
+try {
+  process.exitCode = main();
+} catch (err) {
+  console.error(err.message);
+  process.exitCode = 2;
+}
@@ -0,0 +1,130 @@
+// wasm-check.js - checks the WebAssembly build against the native compiler
+// Loads public/wasm/mini-compiler.js (npm run build:wasm) in Node, compiles
+// each program with both under several option sets, and reports any difference
+// in exit code, stdout or stderr, plus the time per compile of each.
+//
+//   node tools/wasm-check.js --compiler=/path/to/compiler [options] [FILE...]
+//
+//   --compiler=PATH   native compiler to compare with (required)
+//   --module=PATH     built module (default public/wasm/mini-compiler.js)
+//   --args=A;B;...    option sets, separated by ';' (default "" ; -O0 --run ; -O1 ; --max-depth=5)
+//   --repeat=N        compiles per program and option set for the timings (default 5)
+//
+// Without FILEs it uses the IDE's sample and a few error programs. Exits 1 on
+// any mismatch.
+"use strict";
+
+const fs = require("node:fs");
+const path = require("node:path");
+const { spawnSync } = require("node:child_process");
+
+const SAMPLE = "int a;\nint b;\n\na = 5;\nb = a + 10 * (2 - 1);\nprint b;\n";
+const BUILTIN = {
+  sample: SAMPLE,
+  loop: "int i;\nint s;\ni = 0;\ns = 0;\nwhile (i < 100) {\n    s = s + i * i;\n    i = i + 1;\n}\nprint s;\n",
+  "syntax-error": "int a;\na = (1 + ;\n",
+  "semantic-error": "int a;\nprint b;\n",
+  "lex-error": "int a;\na = 1 $ 2;\n",
+};
+
+function parseArgs(argv) {
+  const o = {
+    compiler: "",
+    module: path.join(__dirname, "..", "public", "wasm", "mini-compiler.js"),
+    args: ["", "-O0 --run", "-O1", "--max-depth=5"],
+    repeat: 5,
+    files: [],
+  };
+  for (const arg of argv) {
+    const m = /^--([a-z-]+)(?:=(.*))?$/.exec(arg);
+    if (!m) {
+      o.files.push(arg);
+      continue;
+    }
+    const [, name, v = ""] = m;
+    if (name === "compiler") o.compiler = path.resolve(v);
+    else if (name === "module") o.module = path.resolve(v);
+    else if (name === "args") o.args = v.split(";").map((s) => s.trim());
+    else if (name === "repeat") o.repeat = Math.max(1, Number(v));
+    else throw new Error(`unknown option: --${name}`);
+  }
+  if (!o.compiler) throw new Error("--compiler=PATH is required");
+  return o;
+}
+
+function loadPrograms(files) {
+  if (files.length === 0) return Object.entries(BUILTIN);
+  return files.map((f) => [path.basename(f), fs.readFileSync(f, "utf8")]);
+}
+
+// Same calls as public/compiler-worker.js.
+function wasmCompiler(Module) {
+  const heapString = (s) => {
+    const size = Module.lengthBytesUTF8(s) + 1;
+    const ptr = Module._malloc(size);
+    Module.stringToUTF8(s, ptr, size);
+    return ptr;
+  };
+  return (code, args) => {
+    const src = heapString(code);
+    const argv = heapString(args);
+    try {
+      const exitCode = Module._mini_compile(src, argv);
+      return { exitCode, stdout: Module.UTF8ToString(Module._mini_stdout()), stderr: Module.UTF8ToString(Module._mini_stderr()) };
+    } finally {
+      Module._free(src);
+      Module._free(argv);
+    }
+  };
+}
+
+function nativeCompile(compiler, code, args) {
+  const r = spawnSync(compiler, args.split(/\s+/).filter(Boolean), { input: code, encoding: "utf8", maxBuffer: 1 << 30 });
+  if (r.error) throw r.error;
+  return { exitCode: r.status, stdout: r.stdout, stderr: r.stderr };
+}
+
+function timed(fn, repeat) {
+  let result;
+  const start = process.hrtime.bigint();
+  for (let k = 0; k < repeat; k++) result = fn();
+  return { result, ms: Number(process.hrtime.bigint() - start) / 1e6 / repeat };
+}
+
+function firstDifference(a, b) {
+  for (const key of ["exitCode", "stdout", "stderr"]) {
+    if (a[key] === b[key]) continue;
+    if (key === "exitCode") return `exit ${a.exitCode} vs ${b.exitCode}`;
+    let at = 0;
+    while (a[key][at] === b[key][at]) at++;
+    return `${key} differs at offset ${at}: ${JSON.stringify(a[key].slice(at, at + 40))} vs ${JSON.stringify(b[key].slice(at, at + 40))}`;
+  }
+  return "";
+}
+
+async function main() {
+  const o = parseArgs(process.argv.slice(2));
+  if (!fs.existsSync(o.module)) throw new Error(`${o.module} not found; build it with npm run build:wasm`);
+  const compile = wasmCompiler(await require(o.module)());
+
+  let mismatches = 0;
+  console.log(`${"program".padEnd(20)} ${"options".padEnd(20)} ${"wasm ms".padStart(9)} ${"native ms".padStart(9)}  result`);
+  for (const [name, code] of loadPrograms(o.files)) {
+    for (const args of o.args) {
+      const wasm = timed(() => compile(code, args), o.repeat);
+      const native = timed(() => nativeCompile(o.compiler, code, args), o.repeat);
+      const diff = firstDifference(wasm.result, native.result);
+      if (diff) mismatches++;
+      console.log(
+        `${name.padEnd(20)} ${JSON.stringify(args).padEnd(20)} ${wasm.ms.toFixed(2).padStart(9)} ${native.ms.toFixed(2).padStart(9)}  ${diff || "same"}`,
+      );
+    }
+  }
+  console.log(mismatches ? `${mismatches} mismatch(es)` : "no mismatches");
+  if (mismatches) process.exit(1);
+}
+
+main().catch((err) => {
+  console.error(err.message);
+  process.exit(1);
+});
@@ -0,0 +1,66 @@
+// wasm.cpp - WebAssembly build of the compiler for the browser
+// The whole pipeline of bin/compiler.cpp behind a small C API, for
+// public/compiler-worker.js. What the command-line compiler prints on stdout
+// and stderr is captured into strings.
+//
+//   int mini_compile(const char* source, const char* args)
+//       args as on the command line ("-O1 --max-depth=500"); returns the exit
+//       code (0 ok, 1 error)
+//   const char* mini_stdout(), mini_stderr()
+//       output of the last call, valid until the next one
+//
+// Build (Emscripten; npm run build:wasm runs the same command):
+//   emcc -std=c++17 -O2 -fexceptions -o public/wasm/mini-compiler.js tools/wasm.cpp
+//        -sMODULARIZE=1 -sEXPORT_NAME=createMiniCompiler -sENVIRONMENT=web,worker,node
+//        -sALLOW_MEMORY_GROWTH=1 -sSTACK_SIZE=8388608
+//        -sEXPORTED_FUNCTIONS=_mini_compile,_mini_stdout,_mini_stderr,_malloc,_free
+//        -sEXPORTED_RUNTIME_METHODS=stringToUTF8,lengthBytesUTF8,UTF8ToString
+// Check against the native compiler:
+//   node tools/wasm-check.js --compiler=PATH [FILE...]
+// Without Emscripten the same file builds natively (e.g. g++ -shared -fPIC) for
+// testing the API.
+#define MINI_COMPILER_NO_MAIN
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"   // driver helpers the API does not call
+#include "../bin/compiler.cpp"
+#pragma GCC diagnostic pop
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#else
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+static string g_stdout, g_stderr;
+
+extern "C" {
+
+EMSCRIPTEN_KEEPALIVE int mini_compile(const char* source, const char* args) {
+    ostringstream out, err;
+    int exitCode = 0;
+    {
+        StreamRedirect toOut(cout, out), toErr(cerr, err);
+        try {
+            g_limits = CompileLimits();   // limits do not carry over from the previous call
+            vector<string> words{"compiler"};
+            istringstream in(args ? args : "");
+            for (string w; in >> w;) words.push_back(w);
+            vector<char*> argv;
+            for (auto& w : words) argv.push_back(&w[0]);
+            Options opts = parseOptions((int)argv.size(), argv.data());
+            if (opts.session) throw runtime_error("Option '--session' is not available in the WebAssembly build");
+            compileProgram(opts, source ? source : "");
+        } catch (const exception& ex) {
+            cerr << ex.what() << "\n";
+            exitCode = 1;
+        }
+    }
+    g_stdout = out.str();
+    g_stderr = err.str();
+    return exitCode;
+}
+
+EMSCRIPTEN_KEEPALIVE const char* mini_stdout() { return g_stdout.c_str(); }
+EMSCRIPTEN_KEEPALIVE const char* mini_stderr() { return g_stderr.c_str(); }
+
+}
@@ -0,0 +1,149 @@
+// workload.h - seeded generator of valid programs for the mini compiler
+// Shared by tools/gen.cpp (prints one program) and tools/bench.cpp (the
+// "synthetic" shape and the scaling report). Every program it produces
+// passes lexing, parsing and semantic analysis: variables are declared
+// before use, divisors are non-zero constants and every while loop counts a
+// dedicated counter up to a small bound. The random source is a fixed
+// splitmix64, so a seed gives the same program on every platform.
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+struct WorkloadParams {
+    uint64_t seed = 1;
+    int decls = 64;              // scalar variables declared up front
+    int stmts = 1000;            // top-level statements
+    int depth = 4;               // maximum expression nesting (size grows roughly like width^depth)
+    int width = 4;               // maximum operands in one operator chain
+    int identLen = 6;            // mean identifier length (uniform in [1, 2 * mean - 1], longer if needed to stay unique)
+    double constDensity = 0.3;   // chance that an expression leaf is a constant
+    double commentRatio = 0.1;   // chance that a line ends with a // comment
+    double repeatRate = 0.0;     // chance that a statement repeats an earlier one verbatim
+    double controlRatio = 0.1;   // chance that a statement is an if/else or a bounded while
+};
+
+class WorkloadGenerator {
+    const WorkloadParams& p;
+    uint64_t state;
+    std::vector<std::string> vars, counters;
+    std::vector<std::string> history;   // top-level statements, for repetition
+    std::string out;
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    int below(int n) { return n <= 1 ? 0 : (int)(next() % (uint64_t)n); }
+    bool chance(double q) { return (double)(next() >> 11) * (1.0 / 9007199254740992.0) < q; }
+
+    // Letters padded in front of the index, so names are unique and never keywords.
+    std::string ident(int k) {
+        std::string digits = std::to_string(k);
+        int len = 1 + below(2 * (p.identLen < 1 ? 1 : p.identLen) - 1);
+        std::string s;
+        do s.push_back((char)('a' + below(26)));
+        while ((int)(s.size() + digits.size()) < len);
+        // Compilers before %tN / %vN temporaries confused t28 or v3 with their own
+        // names; steer clear so bench-gate runs against old commits compare like for like.
+        if (s == "t" || s == "v") s[0]++;
+        return s + digits;
+    }
+
+    std::string leaf() {
+        if (vars.empty() || chance(p.constDensity)) return std::to_string(below(1000));
+        return vars[(size_t)below((int)vars.size())];
+    }
+
+    std::string expr(int d) {
+        if (d >= p.depth || chance(0.25)) return leaf();
+        int n = 2 + below((p.width < 2 ? 2 : p.width) - 1);
+        std::string s = d > 0 ? "(" : "";
+        if (chance(0.1)) s += "-";
+        s += expr(d + 1);
+        for (int k = 1; k < n; k++) {
+            switch (below(4)) {
+                case 0: s += " + " + expr(d + 1); break;
+                case 1: s += " - " + expr(d + 1); break;
+                case 2: s += " * " + expr(d + 1); break;
+                default: s += " / " + std::to_string(1 + below(9)); break;
+            }
+        }
+        return d > 0 ? s + ")" : s;
+    }
+
+    std::string comment() {
+        if (!chance(p.commentRatio)) return "";
+        static const char* words[] = {"update", "the", "running", "value", "keep", "loop", "state", "note", "sum"};
+        std::string s = "  //";
+        for (int k = 1 + below(6); k > 0; k--) s += std::string(" ") + words[below(9)];
+        return s;
+    }
+
+    std::string stmt(int nest, const std::string& indent) {
+        if (nest < 2 && chance(p.controlRatio)) {
+            std::string inner = indent + "    ";
+            if (chance(0.5)) {
+                std::string s = indent + "if (" + expr(1) + " < " + expr(1) + ") {" + comment() + "\n";
+                for (int k = 1 + below(3); k > 0; k--) s += stmt(nest + 1, inner);
+                s += indent + "} else {\n";
+                for (int k = 1 + below(3); k > 0; k--) s += stmt(nest + 1, inner);
+                return s + indent + "}\n";
+            }
+            const std::string& c = counters[(size_t)nest];
+            std::string s = indent + c + " = 0;\n" + indent + "while (" + c + " < " + std::to_string(1 + below(8)) + ") {" +
+                            comment() + "\n";
+            for (int k = 1 + below(3); k > 0; k--) s += stmt(nest + 1, inner);
+            return s + inner + c + " = " + c + " + 1;\n" + indent + "}\n";
+        }
+        if (vars.empty() || chance(0.1)) return indent + "print " + expr(0) + ";" + comment() + "\n";
+        return indent + vars[(size_t)below((int)vars.size())] + " = " + expr(0) + ";" + comment() + "\n";
+    }
+
+public:
+    explicit WorkloadGenerator(const WorkloadParams& params) : p(params), state(params.seed) {}
+
+    std::string generate() {
+        out.clear();
+        for (int k = 0; k < p.decls; k++) vars.push_back(ident(k));
+        for (int k = 0; k < 2; k++) counters.push_back(ident(p.decls + k));
+        for (const auto& v : vars) out += "int " + v + ";" + comment() + "\n";
+        for (const auto& c : counters) out += "int " + c + ";\n";
+        for (const auto& v : vars) out += v + " = " + std::to_string(below(100)) + ";\n";   // no read before write
+        for (int k = 0; k < p.stmts; k++) {
+            if (!history.empty() && chance(p.repeatRate)) {
+                out += history[(size_t)below((int)history.size())];
+                continue;
+            }
+            history.push_back(stmt(0, ""));
+            out += history.back();
+        }
+        return out;
+    }
+};
+
+inline std::string generateWorkload(const WorkloadParams& p) { return WorkloadGenerator(p).generate(); }
+
+// Applies one --name=value option to the parameters; false if it is not one of them.
+inline bool applyWorkloadOption(WorkloadParams& p, const std::string& arg) {
+    size_t eq = arg.find('=');
+    if (arg.rfind("--", 0) != 0 || eq == std::string::npos) return false;
+    std::string name = arg.substr(2, eq - 2);
+    const char* v = arg.c_str() + eq + 1;
+    if (name == "seed") p.seed = std::strtoull(v, nullptr, 10);
+    else if (name == "decls") p.decls = std::atoi(v);
+    else if (name == "stmts") p.stmts = std::atoi(v);
+    else if (name == "depth") p.depth = std::atoi(v);
+    else if (name == "width") p.width = std::atoi(v);
+    else if (name == "ident-len") p.identLen = std::atoi(v);
+    else if (name == "const-density") p.constDensity = std::atof(v);
+    else if (name == "comment-ratio") p.commentRatio = std::atof(v);
+    else if (name == "repeat") p.repeatRate = std::atof(v);
+    else if (name == "control") p.controlRatio = std::atof(v);
+    else return false;
+    return true;
+}
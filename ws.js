@@ -0,0 +1,214 @@
+// ws.js - minimal WebSocket server side (RFC 6455) on Node built-ins
+// Enough for the IDE's compile sessions: the opening handshake on an HTTP
+// "upgrade", text and binary messages (fragmented or not), ping/pong and the
+// closing handshake. No extensions (permessage-deflate) and no subprotocols.
+//
+//   server.on("upgrade", (req, socket, head) => {
+//     const ws = accept(req, socket, head, { maxMessageBytes, keepAliveMs });
+//     if (ws) ws.on("message", (text) => ws.send(text));
+//   });
+//
+// Events: "message" (string for text, Buffer for binary) and "close" (code, reason), once.
+"use strict";
+
+const crypto = require("node:crypto");
+const { EventEmitter } = require("node:events");
+
+const GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+const OP = { continuation: 0, text: 1, binary: 2, close: 8, ping: 9, pong: 10 };
+
+// Answers an upgrade request with a plain HTTP error and drops the connection.
+function reject(socket, status, message) {
+  const body = `${message}\n`;
+  socket.end(
+    `HTTP/1.1 ${status} ${message}\r\nConnection: close\r\nContent-Type: text/plain\r\nContent-Length: ${Buffer.byteLength(body)}\r\n\r\n${body}`,
+  );
+}
+
+// Completes the opening handshake; null (after answering 400) when the request is not a WebSocket one.
+function accept(req, socket, head, options = {}) {
+  const key = req.headers["sec-websocket-key"];
+  if (String(req.headers.upgrade).toLowerCase() !== "websocket" || !key || req.headers["sec-websocket-version"] !== "13") {
+    reject(socket, 400, "Bad Request");
+    return null;
+  }
+  const acceptKey = crypto.createHash("sha1").update(key + GUID).digest("base64");
+  socket.write(
+    ["HTTP/1.1 101 Switching Protocols", "Upgrade: websocket", "Connection: Upgrade", `Sec-WebSocket-Accept: ${acceptKey}`, "", ""].join("\r\n"),
+  );
+  return new WebSocket(socket, head, options);
+}
+
+class WebSocket extends EventEmitter {
+  constructor(socket, head, { maxMessageBytes = 16 << 20, keepAliveMs = 30000 } = {}) {
+    super();
+    this.socket = socket;
+    this.maxMessageBytes = maxMessageBytes;
+    this.chunks = head && head.length ? [head] : [];
+    this.buffered = this.chunks.length ? head.length : 0;
+    this.need = 2; // bytes the next frame needs at least before parsing is worth trying
+    this.fragments = []; // of the message being reassembled
+    this.fragmentBytes = 0;
+    this.fragmentOp = 0;
+    this.closeSent = false;
+    this.closed = false;
+
+    socket.setNoDelay(true);
+    socket.on("data", (chunk) => {
+      this.chunks.push(chunk);
+      this.buffered += chunk.length;
+      if (this.buffered >= this.need) this.readFrames();
+    });
+    socket.on("error", () => socket.destroy());
+    socket.on("close", () => this.finish(1006, ""));
+
+    // A client that stops answering pings is dropped, so its resources are freed.
+    this.alive = true;
+    this.keepAlive = keepAliveMs > 0 ? setInterval(() => this.checkAlive(), keepAliveMs) : null;
+    if (this.chunks.length) process.nextTick(() => this.readFrames());
+  }
+
+  send(data) {
+    const binary = Buffer.isBuffer(data);
+    this.writeFrame(binary ? OP.binary : OP.text, binary ? data : Buffer.from(String(data)));
+  }
+
+  ping() {
+    this.writeFrame(OP.ping, Buffer.alloc(0));
+  }
+
+  close(code = 1000, reason = "") {
+    if (this.closeSent || this.closed) return;
+    const payload = Buffer.alloc(2 + Buffer.byteLength(reason));
+    payload.writeUInt16BE(code, 0);
+    payload.write(reason, 2);
+    this.writeFrame(OP.close, payload);
+    this.closeSent = true;
+    // the client answers with its own close frame; do not wait for ever
+    setTimeout(() => this.socket.destroy(), 2000).unref();
+  }
+
+  checkAlive() {
+    if (!this.alive) {
+      this.socket.destroy();
+      return;
+    }
+    this.alive = false;
+    this.ping();
+  }
+
+  writeFrame(opcode, payload) {
+    if (this.closeSent || this.closed) return;
+    const len = payload.length;
+    let header;
+    if (len < 126) {
+      header = Buffer.from([0x80 | opcode, len]);
+    } else if (len < 65536) {
+      header = Buffer.alloc(4);
+      header[0] = 0x80 | opcode;
+      header[1] = 126;
+      header.writeUInt16BE(len, 2);
+    } else {
+      header = Buffer.alloc(10);
+      header[0] = 0x80 | opcode;
+      header[1] = 127;
+      header.writeBigUInt64BE(BigInt(len), 2);
+    }
+    this.socket.write(header);
+    if (len) this.socket.write(payload);
+  }
+
+  // Parses every complete frame buffered so far.
+  readFrames() {
+    if (this.closed) return;
+    let buf = this.chunks.length === 1 ? this.chunks[0] : Buffer.concat(this.chunks);
+    let pos = 0;
+    let need = 2;
+    for (;;) {
+      need = 2;
+      if (buf.length - pos < need) break;
+      const b0 = buf[pos];
+      const b1 = buf[pos + 1];
+      const fin = (b0 & 0x80) !== 0;
+      const opcode = b0 & 0x0f;
+      let len = b1 & 0x7f;
+      let at = pos + 2;
+      if ((b1 & 0x80) === 0) return this.fail(1002, "client frames must be masked");
+      if (len === 126) {
+        need = 4;
+        if (buf.length - pos < need) break;
+        len = buf.readUInt16BE(at);
+        at += 2;
+      } else if (len === 127) {
+        need = 10;
+        if (buf.length - pos < need) break;
+        const big = buf.readBigUInt64BE(at);
+        if (big > BigInt(this.maxMessageBytes)) return this.fail(1009, "message too big");
+        len = Number(big);
+        at += 8;
+      }
+      if (len > this.maxMessageBytes) return this.fail(1009, "message too big");
+      need = at - pos + 4 + len;
+      if (buf.length - pos < need) break;
+      const mask = buf.subarray(at, at + 4);
+      const payload = Buffer.from(buf.subarray(at + 4, at + 4 + len));
+      for (let k = 0; k < len; k++) payload[k] ^= mask[k & 3];
+      pos = at + 4 + len;
+      this.onFrame(fin, opcode, payload);
+      if (this.closed) return;
+    }
+    buf = buf.subarray(pos);
+    this.chunks = buf.length ? [buf] : [];
+    this.buffered = buf.length;
+    this.need = need;
+  }
+
+  onFrame(fin, opcode, payload) {
+    this.alive = true;
+    if (opcode >= OP.close) {
+      if (!fin) return this.fail(1002, "fragmented control frame");
+      if (opcode === OP.ping) this.writeFrame(OP.pong, payload);
+      else if (opcode === OP.close) {
+        const code = payload.length >= 2 ? payload.readUInt16BE(0) : 1005;
+        this.close(code === 1005 ? 1000 : code);
+        this.socket.end();
+        this.finish(code, payload.subarray(2).toString("utf8"));
+      }
+      return;
+    }
+
+    if (opcode === OP.continuation) {
+      if (!this.fragmentOp) return this.fail(1002, "continuation without a message");
+    } else if (opcode === OP.text || opcode === OP.binary) {
+      if (this.fragmentOp) return this.fail(1002, "new message inside a fragmented one");
+      this.fragmentOp = opcode;
+    } else return this.fail(1002, `unknown opcode ${opcode}`);
+
+    this.fragments.push(payload);
+    this.fragmentBytes += payload.length;
+    if (this.fragmentBytes > this.maxMessageBytes) return this.fail(1009, "message too big");
+    if (!fin) return;
+
+    const data = this.fragments.length === 1 ? this.fragments[0] : Buffer.concat(this.fragments);
+    const op = this.fragmentOp;
+    this.fragments = [];
+    this.fragmentBytes = 0;
+    this.fragmentOp = 0;
+    this.emit("message", op === OP.text ? data.toString("utf8") : data);
+  }
+
+  fail(code, reason) {
+    this.close(code, reason);
+    this.socket.end();
+    this.finish(code, reason);
+  }
+
+  finish(code, reason) {
+    if (this.closed) return;
+    this.closed = true;
+    if (this.keepAlive) clearInterval(this.keepAlive);
+    this.emit("close", code, reason);
+  }
+}
+
+module.exports = { accept, reject };